@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZBenchServer.h"
+#include <QCryptographicHash>
+#include <QList>
+#include <QTcpSocket>
+#include <QTimer>
+#include <cstring>
+
+/* The asset content repeats with a period that is not a power of two, so
+ * aligned chunks don't look alike */
+static const qint64 PATTERN_SIZE = 1024 * 1024 + 7;
+
+/* Data queued in the socket before we wait for it to drain */
+static const qint64 MAX_PENDING = 1024 * 1024;
+
+static const QByteArray &pattern()
+{
+    static const QByteArray data = []() {
+        QByteArray bytes(PATTERN_SIZE, Qt::Uninitialized);
+        quint32 state = 0x12345678;
+        for (qint64 i = 0; i < bytes.size(); ++i) {
+            /* xorshift32 */
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            bytes[i] = char(state);
+        }
+        return bytes;
+    }();
+    return data;
+}
+
+ZBenchServer::ZBenchServer(const Options &options, QObject *parent)
+    : QTcpServer(parent), m_options(options)
+{
+}
+
+/**
+ * Clears the counters, a stall is allowed again
+ */
+void ZBenchServer::resetStats()
+{
+    m_stats = Stats();
+    m_stallClock.invalidate();
+}
+
+void ZBenchServer::countRequest(qint64 rangeStart)
+{
+    ++m_stats.requests;
+    if (rangeStart < 0)
+        return;
+
+    ++m_stats.rangeRequests;
+    if (m_stallClock.isValid() && m_stats.resumedAt < 0) {
+        m_stats.resumedAt = rangeStart;
+        m_stats.stallMs = m_stallClock.elapsed();
+    }
+}
+
+/**
+ * Returns true if the calling response is the one that stalls
+ */
+bool ZBenchServer::stall()
+{
+    if (m_options.stallAt < 0 || m_stats.stalls > 0)
+        return false;
+
+    ++m_stats.stalls;
+    m_stallClock.start();
+    return true;
+}
+
+/**
+ * Writes \a size bytes of the synthetic asset, starting at \a offset, to
+ * \a data
+ */
+void ZBenchServer::fill(char *data, qint64 offset, qint64 size)
+{
+    const QByteArray &bytes = pattern();
+    while (size > 0) {
+        qint64 pos = offset % PATTERN_SIZE;
+        qint64 n = qMin(size, PATTERN_SIZE - pos);
+        memcpy(data, bytes.constData() + pos, size_t(n));
+        data += n;
+        offset += n;
+        size -= n;
+    }
+}
+
+/**
+ * Returns the SHA-256 of the synthetic asset of \a size bytes
+ */
+QByteArray ZBenchServer::sha256(qint64 size)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+    for (qint64 offset = 0; offset < size; offset += buffer.size()) {
+        qint64 n = qMin<qint64>(buffer.size(), size - offset);
+        fill(buffer.data(), offset, n);
+        hash.addData(QByteArrayView(buffer.constData(), n));
+    }
+
+    return hash.result();
+}
+
+void ZBenchServer::incomingConnection(qintptr handle)
+{
+    new ZBenchConnection(handle, this);
+}
+
+ZBenchConnection::ZBenchConnection(qintptr handle, ZBenchServer *server)
+    : QObject(server), m_server(server), m_options(server->options()),
+      m_socket(new QTcpSocket(this)), m_timer(new QTimer(this)),
+      m_busy(false), m_stalled(false), m_pos(0), m_end(0), m_sent(0)
+{
+    m_socket->setSocketDescriptor(handle);
+    m_chunk.resize(qMax<qint64>(m_options.chunkSize, 1));
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+
+    connect(m_socket, &QTcpSocket::readyRead, this,
+            &ZBenchConnection::readRequest);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &ZBenchConnection::pump);
+    connect(m_socket, &QTcpSocket::disconnected, this,
+            &ZBenchConnection::deleteLater);
+    connect(m_timer, &QTimer::timeout, this, &ZBenchConnection::pump);
+}
+
+void ZBenchConnection::readRequest()
+{
+    m_request += m_socket->readAll();
+
+    /* One request at a time, pipelined ones wait for the response */
+    while (!m_busy) {
+        int end = m_request.indexOf("\r\n\r\n");
+        if (end < 0)
+            return;
+
+        QList<QByteArray> lines = m_request.left(end).split('\n');
+        m_request.remove(0, end + 4);
+
+        QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.size() < 2) {
+            sendError(400, "Bad Request");
+            continue;
+        }
+
+        QByteArray range;
+        for (const QByteArray &line : lines) {
+            if (line.toLower().startsWith("range:"))
+                range = line.mid(6).trimmed();
+        }
+
+        respond(requestLine.at(0), requestLine.at(1), range);
+    }
+}
+
+void ZBenchConnection::respond(const QByteArray &method,
+                               const QByteArray &path,
+                               const QByteArray &range)
+{
+    /* /asset/<size>.bin */
+    bool ok = false;
+    qint64 size = -1;
+    if (path.startsWith("/asset/") && path.endsWith(".bin"))
+        size = path.mid(7, path.size() - 11).toLongLong(&ok);
+
+    if (!ok || size < 0)
+        return sendError(404, "Not Found");
+
+    if (method != "GET" && method != "HEAD")
+        return sendError(405, "Method Not Allowed");
+
+    m_pos = 0;
+    m_end = size;
+    QByteArray status = "200 OK";
+    QByteArray headers;
+
+    /* bytes=<begin>-[<end>] */
+    bool ranged = range.startsWith("bytes=") && !range.contains(',');
+    QList<QByteArray> bounds = range.mid(6).split('-');
+    m_server->countRequest(ranged ? bounds.value(0).toLongLong() : -1);
+
+    if (ranged && !m_options.ignoreRanges) {
+        qint64 begin = bounds.value(0).toLongLong();
+        qint64 last = bounds.value(1).isEmpty() ? size - 1
+                                                : bounds.value(1).toLongLong();
+        last = qMin(last, size - 1);
+        if (begin > last)
+            return sendError(416, "Range Not Satisfiable");
+
+        m_pos = begin;
+        m_end = last + 1;
+        status = "206 Partial Content";
+        headers += "Content-Range: bytes " + QByteArray::number(begin) + '-' +
+                   QByteArray::number(last) + '/' + QByteArray::number(size) +
+                   "\r\n";
+    }
+
+    headers += "Content-Length: " + QByteArray::number(m_end - m_pos) +
+               "\r\n";
+    headers += "Content-Type: application/octet-stream\r\n"
+               "ETag: \"bench-" + QByteArray::number(size) + "\"\r\n";
+    if (!m_options.ignoreRanges)
+        headers += "Accept-Ranges: bytes\r\n";
+
+    if (method == "HEAD")
+        m_end = m_pos;
+
+    m_busy = true;
+    m_sent = 0;
+    m_headers = "HTTP/1.1 " + status + "\r\n" + headers + "\r\n";
+
+    /* The latency applies to the headers, like a slow server would */
+    m_timer->start(m_options.latency);
+}
+
+void ZBenchConnection::sendError(int status, const QByteArray &reason)
+{
+    m_socket->write("HTTP/1.1 " + QByteArray::number(status) + ' ' + reason +
+                    "\r\nContent-Length: 0\r\n\r\n");
+}
+
+/**
+ * Writes the next chunks of the response, as fast as the socket drains them
+ * or as the bandwidth allows
+ */
+void ZBenchConnection::pump()
+{
+    if (!m_busy || m_stalled || m_timer->isActive())
+        return;
+
+    if (!m_headers.isEmpty()) {
+        m_socket->write(m_headers);
+        m_headers.clear();
+        m_clock.start();
+    }
+
+    while (m_pos < m_end && m_socket->bytesToWrite() < MAX_PENDING) {
+        /* Hold back until the bandwidth allows the next chunk */
+        if (m_options.bandwidth > 0) {
+            qint64 due = m_sent * 1000 / m_options.bandwidth;
+            if (due > m_clock.elapsed()) {
+                m_timer->start(int(due - m_clock.elapsed()));
+                return;
+            }
+        }
+
+        qint64 n = qMin<qint64>(m_chunk.size(), m_end - m_pos);
+
+        /* Go silent in the middle of the body, the connection stays open */
+        if (m_pos <= m_options.stallAt && m_pos + n > m_options.stallAt &&
+            m_server->stall()) {
+            n = m_options.stallAt - m_pos;
+            m_stalled = true;
+        }
+
+        ZBenchServer::fill(m_chunk.data(), m_pos, n);
+        m_socket->write(m_chunk.constData(), n);
+        m_server->countSent(n);
+        m_pos += n;
+        m_sent += n;
+
+        if (m_stalled)
+            return;
+    }
+
+    if (m_pos < m_end)
+        return;
+
+    /* Response complete, go on with the next request */
+    m_busy = false;
+    if (!m_request.isEmpty())
+        QTimer::singleShot(0, this, &ZBenchConnection::readRequest);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZBENCH_SERVER_H
+#define ZBENCH_SERVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTcpServer>
+
+class QTcpSocket;
+class QTimer;
+
+/**
+ * Minimal HTTP/1.1 server for the benchmark.
+ *
+ * Serves synthetic assets at "/asset/<size>.bin", generated on the fly so
+ * that even multi-gigabyte files need no memory or disk. GET and HEAD are
+ * supported, with single byte ranges and keep-alive, which is all the
+ * downloader needs for single-stream and segmented transfers.
+ *
+ * Every response can be delayed by a fixed latency, written in chunks of a
+ * given size and shaped to a given bandwidth per connection. To exercise the
+ * client's recovery, the first response that gets past stallAt bytes of its
+ * asset stops sending there and never resumes. With ignoreRanges, every
+ * response is a full 200 whatever the Range header asks for, like a CDN
+ * without range support.
+ *
+ * stats() counts the requests, and must be called from the server thread.
+ */
+class ZBenchServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        qint64 chunkSize = 64 * 1024;
+        int latency = 0;
+        qint64 bandwidth = 0;
+        qint64 stallAt = -1;
+        bool ignoreRanges = false;
+    };
+
+    struct Stats {
+        int requests = 0;
+        int rangeRequests = 0;
+        int stalls = 0;
+        qint64 resumedAt = -1;  // Start of the first range after the stall
+        qint64 stallMs = -1;    // Time from the stall to that request
+        qint64 bytesSent = 0;   // Body bytes written to all connections
+    };
+
+    explicit ZBenchServer(const Options &options, QObject *parent = nullptr);
+
+    const Options &options() const { return m_options; }
+    Stats stats() const { return m_stats; }
+    void resetStats();
+
+    static void fill(char *data, qint64 offset, qint64 size);
+    static QByteArray sha256(qint64 size);
+
+protected:
+    void incomingConnection(qintptr handle) override;
+
+private:
+    friend class ZBenchConnection;
+
+    void countRequest(qint64 rangeStart);
+    void countSent(qint64 bytes) { m_stats.bytesSent += bytes; }
+    bool stall();
+
+    Options m_options;
+    Stats m_stats;
+    QElapsedTimer m_stallClock;
+};
+
+/**
+ * One client connection of the benchmark server
+ */
+class ZBenchConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    ZBenchConnection(qintptr handle, ZBenchServer *server);
+
+private slots:
+    void readRequest();
+    void pump();
+
+private:
+    void respond(const QByteArray &method, const QByteArray &path,
+                 const QByteArray &range);
+    void sendError(int status, const QByteArray &reason);
+
+    ZBenchServer *m_server;
+    ZBenchServer::Options m_options;
+    QTcpSocket *m_socket;
+    QTimer *m_timer;
+    QByteArray m_request;
+    QByteArray m_headers;
+    QByteArray m_chunk;
+
+    bool m_busy;
+    bool m_stalled;
+    qint64 m_pos;
+    qint64 m_end;
+    qint64 m_sent;
+    QElapsedTimer m_clock;
+};
+
+#endif
@@ -0,0 +1,1004 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * zupdater_bench: downloads synthetic assets from an in-process HTTP server
+ * through the regular download path and prints one JSON object per run.
+ *
+ *   zupdater_bench --sizes 1M,64M,1G --chunk 16K --latency 20 --segments 4
+ *
+ * Several connection counts are compared with e.g. --segments 1,4,8. With a
+ * --bandwidth per connection, the highest count must then be at least
+ * SEGMENT_MIN_EFFICIENCY times as much faster than a single connection as
+ * it has connections, e.g. --sizes 16M --bandwidth 2M --segments 1,4,8.
+ *
+ * Disk write strategies are compared by downloading to different
+ * filesystems, e.g. --dir /dev/shm against a directory on ext4, with and
+ * without --no-prealloc, --no-sync and a larger --write-buffer.
+ *
+ * With --queue, all the sizes are downloaded together through a
+ * ZDownloadQueue, once with the given number of connections and once one
+ * after the other, e.g. --sizes 64K,64K,64K,64M --latency 50 --queue 4.
+ *
+ * --rss-limit fails every run whose peak RSS grows by more than the limit
+ * while it downloads, which holds the memory use to the read and write
+ * buffers whatever the size of the asset, e.g. --sizes 1G --rss-limit 16M.
+ * The server shares the process and adds up to 1 MiB per connection.
+ *
+ * With a --rate-limit, every download that takes at least RATE_MIN_SECONDS at
+ * that rate must reach it within RATE_TOLERANCE, after allowing for the
+ * initial burst of a full token bucket, e.g. --sizes 16M --rate-limit 2M.
+ *
+ * With --stall, the server stops sending in the middle of the first response
+ * of every run, e.g. --sizes 16M --stall 4M. The run fails unless the
+ * transfer notices it after ZTransfer::StallTimeout and resumes where the
+ * data stopped.
+ *
+ * Every download run also times how late a fast main thread timer fires, the
+ * time a user interface would have been frozen. A run fails if the longest
+ * of these stalls exceeds --main-stall-limit, MAIN_STALL_LIMIT_MS by default.
+ *
+ * --ignore-ranges makes the server answer every request with the whole asset.
+ * A segmented download must then fall back to a single stream without its
+ * probe receiving much more than RANGE_PROBE_SLACK of the asset first, e.g.
+ * --sizes 256M --segments 4 --ignore-ranges.
+ *
+ * --versions skips the downloads and times ZVersion parsing and comparison
+ * of typical release tags instead, after checking their order.
+ *
+ * --parser times ZReleaseParser on a synthetic release list, fed in network
+ * sized chunks, against QJsonDocument. Both must extract the same releases,
+ * and the streaming parser must not be the slower one. Where the heap can be
+ * measured (glibc), one more pass of each tracks the peak of live heap
+ * allocations above the list itself, which must not be higher for the
+ * streaming parser either.
+ *
+ * --matcher times ZUpdateClient::getMatchingAsset() against compiling a
+ * regex for every asset, as the updater used to. Both must pick the same
+ * asset, and the cached matcher must not be the slower one.
+ */
+
+#include "ZBenchServer.h"
+#include "ZDownloadQueue.h"
+#include "ZReleaseParser.h"
+#include "ZTransfer.h"
+#include "ZUpdateClient.h"
+#include "ZVersion.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#define ZBENCH_HEAP_INFO
+#include <malloc.h>
+#endif
+
+/* Release tags in ascending order, as they are parsed at runtime */
+static const char *const ORDERED_TAGS[] = {
+    "v0.9",          "1.0.0-alpha",  "1.0.0-alpha.1", "1.0.0-alpha.beta",
+    "1.0.0-beta",    "1.0.0-beta.2", "1.0.0-beta.11", "1.0.0-rc.1",
+    "v1.0.0",        "1.0.1-rc1",    "1.0.1",         "release-1.1",
+    "1.1.9",         "v1.1.10",      "1.2.0.1",       "2.0.0-alpha",
+    "v2.0.0+build7", "10.0",
+};
+
+/* Shape of the synthetic release list, and the size of the chunks it is
+ * fed to ZReleaseParser in */
+static const int PARSER_RELEASES = 30;
+static const int PARSER_ASSETS = 12;
+static const int PARSER_CHUNK = 16 * 1024;
+
+/* Release assets for every platform, the way they are usually named */
+static const char *const MATCHER_ASSETS[] = {
+    "App-2.1.0-Windows_x86_64.msi",       "App-2.1.0-Windows_arm64.msi",
+    "App-2.1.0-Windows_x86_64.portable.zip",
+    "App-2.1.0-Windows_arm64.portable.zip",
+    "App-2.1.0-Apple_Intel.dmg",          "App-2.1.0-Apple_Silicon.dmg",
+    "App-2.1.0-Linux_x86_64.AppImage.zsync",
+    "App-2.1.0-Linux_arm64.AppImage.zsync",
+    "App-2.1.0-Linux_x86_64.AppImage",    "App-2.1.0-Linux_arm64.AppImage",
+    "App-2.1.0-source.tar.gz",            "SHA256SUMS",
+};
+
+/* Main thread timer used to detect stalls, and the lateness that counts */
+static const int STALL_TICK_MS = 1;
+static const int STALL_THRESHOLD_MS = 10;
+
+/* Longest main thread stall a download run may cause, a delay users notice */
+static const int MAIN_STALL_LIMIT_MS = 100;
+
+/* Scheduling leeway when checking how long a stalled connection took to be
+ * dropped and resumed */
+static const int STALL_LEEWAY_MS = 3000;
+
+/* What the range probe may receive from a server that ignores ranges before
+ * it is dropped, the socket buffers of both ends included */
+static const qint64 RANGE_PROBE_SLACK = 16 * 1024 * 1024;
+
+/* Share of the ideal speedup that N connections must reach when each one is
+ * shaped to the server bandwidth, the probe request and the ramp-up of the
+ * connections take the rest */
+static const double SEGMENT_MIN_EFFICIENCY = 0.5;
+
+/* Shortest rate limited download whose throughput is checked, how far it
+ * may be off the limit, and the burst the token bucket allows up front */
+static const double RATE_MIN_SECONDS = 2;
+static const double RATE_TOLERANCE = 0.1;
+static const double RATE_BURST_SECONDS = 0.25;
+
+/**
+ * Parses sizes like "512K", "64M" or "4G"
+ */
+static qint64 parseSize(const QString &text)
+{
+    QString value = text.trimmed().toUpper();
+    qint64 unit = 1;
+    if (value.endsWith('K'))
+        unit = 1024;
+    else if (value.endsWith('M'))
+        unit = 1024 * 1024;
+    else if (value.endsWith('G'))
+        unit = 1024 * 1024 * 1024;
+    if (unit > 1)
+        value.chop(1);
+
+    bool ok = false;
+    qint64 size = value.toLongLong(&ok);
+    return ok ? size * unit : -1;
+}
+
+/**
+ * CPU time of the process, or of the calling thread, in seconds
+ */
+static double cpuSeconds(bool thread)
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+#ifdef RUSAGE_THREAD
+    int who = thread ? RUSAGE_THREAD : RUSAGE_SELF;
+#else
+    if (thread)
+        return 0;
+    int who = RUSAGE_SELF;
+#endif
+    if (getrusage(who, &usage) != 0)
+        return 0;
+
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#else
+    Q_UNUSED(thread);
+    return 0;
+#endif
+}
+
+/**
+ * Reads a "<key>: <value>" line from a /proc file, -1 if it is not there
+ */
+static qint64 procValue(const QString &file, const QByteArray &key)
+{
+    QFile proc(file);
+    if (!proc.open(QIODevice::ReadOnly))
+        return -1;
+
+    const QList<QByteArray> lines = proc.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith(key + ':'))
+            return line.mid(key.size() + 1).trimmed().split(' ').first()
+                .toLongLong();
+    }
+
+    return -1;
+}
+
+/**
+ * Resets the peak RSS so that every run reports its own (Linux only)
+ */
+static void resetPeakRss()
+{
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly))
+        clearRefs.write("5");
+}
+
+static qint64 peakRssKb()
+{
+    qint64 peak = procValue("/proc/self/status", "VmHWM");
+#ifdef Q_OS_UNIX
+    if (peak < 0) {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            peak = usage.ru_maxrss;
+    }
+#endif
+    return peak;
+}
+
+/**
+ * Returns the bytes allocated on the heap and not freed yet, -1 if the C
+ * library can't tell
+ */
+static qint64 heapInUse()
+{
+#ifdef ZBENCH_HEAP_INFO
+    struct mallinfo2 info = mallinfo2();
+    return qint64(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Checks the order of ORDERED_TAGS through ZVersion::fromString() and times
+ * parsing and comparing them. Returns the number of misordered pairs.
+ */
+static int runVersions(QTextStream &out, int iterations)
+{
+    QList<QString> tags;
+    for (const char *tag : ORDERED_TAGS)
+        tags.append(QString::fromLatin1(tag));
+
+    int failures = 0;
+    for (int i = 0; i < tags.size(); ++i) {
+        for (int j = 0; j < tags.size(); ++j) {
+            int expected = i < j ? -1 : (i > j ? 1 : 0);
+            int got = ZVersion::fromString(tags.at(i))
+                          .compare(ZVersion::fromString(tags.at(j)));
+            if (qBound(-1, got, 1) != expected) {
+                qCritical() << "Wrong order:" << tags.at(i) << "vs"
+                            << tags.at(j) << "is" << got;
+                ++failures;
+            }
+        }
+    }
+
+    /* The checksum keeps the compiler from dropping the loops */
+    QList<ZVersion> versions(tags.size());
+    quint64 checksum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int n = 0; n < iterations; ++n) {
+        for (int i = 0; i < tags.size(); ++i) {
+            versions[i] = ZVersion::fromString(tags.at(i));
+            checksum += versions.at(i).isPrerelease();
+        }
+    }
+    qint64 parseNs = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int n = 0; n < iterations; ++n) {
+        for (int i = 0; i < versions.size(); ++i) {
+            for (int j = 0; j < versions.size(); ++j)
+                checksum += versions.at(i) < versions.at(j);
+        }
+    }
+    qint64 compareNs = timer.nsecsElapsed();
+
+    qint64 parses = qint64(iterations) * tags.size();
+    qint64 compares = parses * tags.size();
+
+    QJsonObject result;
+    result["mode"] = "versions";
+    result["tags"] = int(tags.size());
+    result["ok"] = failures == 0;
+    result["misordered"] = failures;
+    result["parses"] = parses;
+    result["parse_ns"] = double(parseNs) / parses;
+    result["compares"] = compares;
+    result["compare_ns"] = double(compareNs) / compares;
+    result["checksum"] = QString::number(checksum);
+
+    out << QJsonDocument(result).toJson(QJsonDocument::Compact) << Qt::endl;
+    return failures;
+}
+
+/**
+ * Returns a release list shaped like GitHub's, with all the fields the
+ * parser has to skip
+ */
+static QByteArray releaseList()
+{
+    QJsonObject user;
+    user["login"] = "uncor3";
+    user["id"] = 1234567;
+    user["node_id"] = "MDQ6VXNlcjEyMzQ1Njc=";
+    user["avatar_url"] = "https://avatars.githubusercontent.com/u/1234567";
+    user["html_url"] = "https://github.com/uncor3";
+    user["type"] = "User";
+    user["site_admin"] = false;
+
+    QJsonArray releases;
+    for (int r = PARSER_RELEASES; r > 0; --r) {
+        QString tag = QString("v1.%1.0").arg(r);
+        QString base = "https://github.com/owner/app/releases/download/" + tag;
+
+        QJsonArray assets;
+        for (int a = 0; a < PARSER_ASSETS; ++a) {
+            QString name = QString("app-%1-%2.bin").arg(tag).arg(a);
+            QJsonObject asset;
+            asset["url"] = "https://api.github.com/repos/owner/app/assets/1";
+            asset["id"] = r * 100 + a;
+            asset["name"] = name;
+            asset["label"] = QJsonValue();
+            asset["uploader"] = user;
+            asset["content_type"] = "application/octet-stream";
+            asset["state"] = "uploaded";
+            asset["size"] = 50000000 + r * 1000 + a;
+            asset["digest"] = "sha256:" + QString(64, QChar('a' + a % 6));
+            asset["download_count"] = r * a;
+            asset["created_at"] = "2025-01-01T00:00:00Z";
+            asset["browser_download_url"] = base + '/' + name;
+            assets.append(asset);
+        }
+
+        QJsonObject release;
+        release["url"] = "https://api.github.com/repos/owner/app/releases/1";
+        release["id"] = r;
+        release["author"] = user;
+        release["tag_name"] = tag;
+        release["name"] = "Release " + tag;
+        release["draft"] = false;
+        release["prerelease"] = r % 5 == 0;
+        release["created_at"] = "2025-01-01T00:00:00Z";
+        release["assets"] = assets;
+        release["html_url"] =
+            "https://github.com/owner/app/releases/tag/" + tag;
+        release["body"] = QString("## Changes in %1\n\n- Fixed \"quoted\" "
+                                  "things\n- Caf\u00e9 \\ paths\n")
+                              .arg(tag)
+                              .repeated(20);
+        releases.append(release);
+    }
+
+    return QJsonDocument(releases).toJson(QJsonDocument::Compact);
+}
+
+/**
+ * Flattens the fields the updater reads from \a release, so that both
+ * parsers can be compared whatever number types they produce
+ */
+static QString releaseFields(const QJsonObject &release)
+{
+    QStringList fields = {release.value("tag_name").toString(),
+                          release.value("prerelease").toBool() ? "pre" : "",
+                          release.value("body").toString(),
+                          release.value("html_url").toString()};
+
+    const QJsonArray assets = release.value("assets").toArray();
+    for (const QJsonValue &value : assets) {
+        QJsonObject asset = value.toObject();
+        fields << asset.value("name").toString()
+               << asset.value("browser_download_url").toString()
+               << QString::number(asset.value("size").toInteger())
+               << asset.value("digest").toString();
+    }
+
+    return fields.join('|');
+}
+
+/**
+ * Times ZReleaseParser against QJsonDocument on the same release list.
+ * Returns 1 if they disagree or the streaming parser is slower.
+ */
+static int runParser(QTextStream &out, int iterations)
+{
+    const QByteArray data = releaseList();
+
+    QStringList expected;
+    QStringList streamed;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int n = 0; n < iterations; ++n) {
+        expected.clear();
+        const QJsonArray releases = QJsonDocument::fromJson(data).array();
+        for (const QJsonValue &release : releases)
+            expected.append(releaseFields(release.toObject()));
+    }
+    qint64 jsonNs = timer.nsecsElapsed();
+
+    bool parsed = true;
+    ZReleaseParser parser;
+    timer.restart();
+    for (int n = 0; n < iterations; ++n) {
+        streamed.clear();
+        parser.reset();
+        for (qsizetype pos = 0; pos < data.size(); pos += PARSER_CHUNK) {
+            parsed = parser.feed(data.mid(pos, PARSER_CHUNK)) && parsed;
+            while (parser.hasRelease())
+                streamed.append(releaseFields(parser.takeRelease()));
+        }
+        parsed = parsed && parser.atEnd();
+    }
+    qint64 parserNs = timer.nsecsElapsed();
+
+    /* Peak heap of one more pass each, the fields are extracted and
+     * dropped so that only what the parsers hold on to counts. Unlike the
+     * RSS, this doesn't depend on the pages earlier runs left behind. */
+    qint64 base = heapInUse();
+    qint64 jsonHeap = -1;
+    if (base >= 0) {
+        const QJsonDocument document = QJsonDocument::fromJson(data);
+        jsonHeap = heapInUse() - base;
+        const QJsonArray releases = document.array();
+        for (const QJsonValue &release : releases) {
+            releaseFields(release.toObject());
+            jsonHeap = qMax(jsonHeap, heapInUse() - base);
+        }
+    }
+
+    base = heapInUse();
+    qint64 parserHeap = -1;
+    if (base >= 0) {
+        parser.reset();
+        for (qsizetype pos = 0; pos < data.size(); pos += PARSER_CHUNK) {
+            parser.feed(data.mid(pos, PARSER_CHUNK));
+            parserHeap = qMax(parserHeap, heapInUse() - base);
+            while (parser.hasRelease()) {
+                releaseFields(parser.takeRelease());
+                parserHeap = qMax(parserHeap, heapInUse() - base);
+            }
+        }
+        parser.reset();
+    }
+
+    bool same = parsed && streamed == expected &&
+                expected.size() == PARSER_RELEASES;
+    bool faster = parserNs <= jsonNs;
+    bool smaller = parserHeap <= jsonHeap;
+    if (!parsed)
+        qCritical() << "Release parser failed:" << parser.errorString();
+    else if (!same)
+        qCritical() << "Release parser and QJsonDocument disagree";
+
+    double megabytes = double(data.size()) * iterations / 1048576.0;
+
+    QJsonObject result;
+    result["mode"] = "parser";
+    result["bytes"] = data.size();
+    result["releases"] = int(expected.size());
+    result["iterations"] = iterations;
+    result["ok"] = same && faster && smaller;
+    result["same_result"] = same;
+    result["json_mb_per_s"] = megabytes / (jsonNs / 1e9);
+    result["parser_mb_per_s"] = megabytes / (parserNs / 1e9);
+    result["speedup"] = double(jsonNs) / qMax<qint64>(parserNs, 1);
+    result["json_peak_heap_kb"] = jsonHeap < 0 ? -1 : jsonHeap / 1024;
+    result["parser_peak_heap_kb"] = parserHeap < 0 ? -1 : parserHeap / 1024;
+
+    out << QJsonDocument(result).toJson(QJsonDocument::Compact) << Qt::endl;
+    return same && faster && smaller ? 0 : 1;
+}
+
+/**
+ * Times the asset matcher on a typical asset list for this platform.
+ * Returns 1 if it disagrees with a plain regex match or is slower.
+ */
+static int runMatcher(QTextStream &out, int iterations)
+{
+    ZUpdateClient client(QString(), QString());
+    QString pattern = client.detectAssetPattern();
+    if (pattern.isEmpty())
+        pattern = ".*-Linux_x86_64\\.appimage$";
+
+    QJsonArray assets;
+    for (const char *name : MATCHER_ASSETS) {
+        QJsonObject asset;
+        asset["name"] = QString::fromLatin1(name);
+        assets.append(asset);
+    }
+
+    /* What getMatchingAsset() did before the pattern was cached */
+    QString expected;
+    QElapsedTimer timer;
+    timer.start();
+    for (int n = 0; n < iterations; ++n) {
+        expected.clear();
+        for (const QJsonValue &value : std::as_const(assets)) {
+            QString name = value.toObject().value("name").toString();
+            QRegularExpression regex(pattern,
+                                     QRegularExpression::CaseInsensitiveOption);
+            if (regex.match(name).hasMatch()) {
+                expected = name;
+                break;
+            }
+        }
+    }
+    qint64 regexNs = timer.nsecsElapsed();
+
+    QString matched;
+    timer.restart();
+    for (int n = 0; n < iterations; ++n)
+        matched = client.getMatchingAsset(pattern, assets)
+                      .value("name")
+                      .toString();
+    qint64 matcherNs = timer.nsecsElapsed();
+
+    bool same = !expected.isEmpty() && matched == expected;
+    bool faster = matcherNs <= regexNs;
+    if (!same)
+        qCritical() << "Asset matcher picked" << matched << "instead of"
+                    << expected;
+
+    QJsonObject result;
+    result["mode"] = "matcher";
+    result["pattern"] = pattern;
+    result["assets"] = int(assets.size());
+    result["iterations"] = iterations;
+    result["ok"] = same && faster;
+    result["same_result"] = same;
+    result["regex_ns"] = double(regexNs) / iterations;
+    result["matcher_ns"] = double(matcherNs) / iterations;
+    result["speedup"] = double(regexNs) / qMax<qint64>(matcherNs, 1);
+
+    out << QJsonDocument(result).toJson(QJsonDocument::Compact) << Qt::endl;
+    return same && faster ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("zupdater_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ZUpdater download benchmark");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"sizes", "Comma separated asset sizes.", "list", "1M,16M,256M"},
+        {"chunk", "Server write size.", "size", "64K"},
+        {"latency", "Server response latency in ms.", "ms", "0"},
+        {"bandwidth", "Server bandwidth per connection, 0 for none.",
+         "bytes/s", "0"},
+        {"segments", "Comma separated download connection counts.", "list",
+         "1"},
+        {"rate-limit", "Client rate limit, 0 for none.", "bytes/s", "0"},
+        {"repeat", "Runs per size.", "count", "1"},
+        {"verify", "Verify the SHA-256 of every download."},
+        {"dir", "Download directory, a temporary one by default.", "path"},
+        {"write-buffer", "Size of the coalesced file writes.", "size",
+         "256K"},
+        {"no-prealloc", "Don't reserve the disk space up front."},
+        {"no-sync", "Don't sync the file before renaming it."},
+        {"queue", "Download all the sizes at once through a queue.",
+         "connections"},
+        {"versions", "Time version parsing and comparison instead.",
+         "iterations"},
+        {"parser", "Time the release parser against QJsonDocument instead.",
+         "iterations"},
+        {"matcher", "Time the asset matcher against plain regexes instead.",
+         "iterations"},
+        {"stall", "Stall the first response of every run at this offset.",
+         "size"},
+        {"rss-limit", "Fail runs whose peak RSS grows by more than this.",
+         "size"},
+        {"ignore-ranges", "Serve every request in full, ignoring ranges."},
+        {"main-stall-limit", "Fail runs that stall the main thread longer.",
+         "ms", QString::number(MAIN_STALL_LIMIT_MS)},
+    });
+    parser.process(app);
+
+    if (parser.isSet("versions")) {
+        QTextStream out(stdout);
+        int iterations = qMax(1, parser.value("versions").toInt());
+        return runVersions(out, iterations) > 0 ? 1 : 0;
+    }
+
+    if (parser.isSet("parser")) {
+        QTextStream out(stdout);
+        return runParser(out, qMax(1, parser.value("parser").toInt()));
+    }
+
+    if (parser.isSet("matcher")) {
+        QTextStream out(stdout);
+        return runMatcher(out, qMax(1, parser.value("matcher").toInt()));
+    }
+
+    ZBenchServer::Options options;
+    options.chunkSize = parseSize(parser.value("chunk"));
+    options.latency = parser.value("latency").toInt();
+    options.bandwidth = parseSize(parser.value("bandwidth"));
+    if (parser.isSet("stall"))
+        options.stallAt = parseSize(parser.value("stall"));
+    options.ignoreRanges = parser.isSet("ignore-ranges");
+
+    /* A stalled response is resumed with a range */
+    if (options.stallAt >= 0 && options.ignoreRanges) {
+        qCritical() << "--stall needs range support, drop --ignore-ranges";
+        return 1;
+    }
+
+    QList<qint64> sizes;
+    for (const QString &text : parser.value("sizes").split(',')) {
+        qint64 size = parseSize(text);
+        if (size < 0) {
+            qCritical() << "Invalid size" << text;
+            return 1;
+        }
+        if (options.stallAt >= size) {
+            qCritical() << "Size" << text << "is too small to stall at"
+                        << options.stallAt;
+            return 1;
+        }
+        sizes.append(size);
+    }
+
+    /* The stall check follows the single connection retry path */
+    QList<int> segmentCounts;
+    for (const QString &text : parser.value("segments").split(',')) {
+        int count = text.toInt();
+        if (count < 1) {
+            qCritical() << "Invalid segment count" << text;
+            return 1;
+        }
+        if (!segmentCounts.contains(count))
+            segmentCounts.append(count);
+    }
+    if (parser.isSet("stall"))
+        segmentCounts = {1};
+
+    int mainStallLimit = parser.value("main-stall-limit").toInt();
+
+    /* The server gets its own thread, so it neither competes with the
+     * main thread we measure nor with the transfer thread */
+    QThread serverThread;
+    serverThread.setObjectName("bench server");
+    serverThread.start();
+
+    ZBenchServer *server = new ZBenchServer(options);
+    server->moveToThread(&serverThread);
+    QObject::connect(&serverThread, &QThread::finished, server,
+            &ZBenchServer::deleteLater);
+
+    quint16 port = 0;
+    QMetaObject::invokeMethod(
+        server,
+        [server, &port]() {
+            if (server->listen(QHostAddress::LocalHost))
+                port = server->serverPort();
+        },
+        Qt::BlockingQueuedConnection);
+
+    if (port == 0) {
+        qCritical() << "Cannot start the server";
+        return 1;
+    }
+
+    auto serverCpu = [server]() {
+        double cpu = 0;
+        QMetaObject::invokeMethod(
+            server, [&cpu]() { cpu = cpuSeconds(true); },
+            Qt::BlockingQueuedConnection);
+        return cpu;
+    };
+
+    auto serverStats = [server]() {
+        ZBenchServer::Stats stats;
+        QMetaObject::invokeMethod(
+            server, [server, &stats]() { stats = server->stats(); },
+            Qt::BlockingQueuedConnection);
+        return stats;
+    };
+
+    /* Compare filesystems by pointing --dir at them */
+    QString base = parser.isSet("dir") ? parser.value("dir") : QDir::tempPath();
+    QTemporaryDir dir(base + "/zupdater_bench-XXXXXX");
+    if (!dir.isValid()) {
+        qCritical() << "Cannot create the download directory";
+        return 1;
+    }
+
+    ZWriteStrategy writeStrategy;
+    writeStrategy.bufferSize = parseSize(parser.value("write-buffer"));
+    writeStrategy.preallocate = !parser.isSet("no-prealloc");
+    writeStrategy.sync = !parser.isSet("no-sync");
+
+    ZUpdateClient client(QString(), QString());
+    client.setDownloadRateLimit(parseSize(parser.value("rate-limit")));
+    client.setWriteStrategy(writeStrategy);
+
+    /* Lateness of a fast main thread timer is the time the user interface
+     * would have been frozen */
+    QElapsedTimer tickClock;
+    qint64 lastTick = 0;
+    qint64 stallTotal = 0;
+    qint64 stallMax = 0;
+    QTimer ticker;
+    ticker.setTimerType(Qt::PreciseTimer);
+    ticker.setInterval(STALL_TICK_MS);
+    QObject::connect(&ticker, &QTimer::timeout, [&]() {
+        qint64 now = tickClock.elapsed();
+        qint64 late = now - lastTick - STALL_TICK_MS;
+        lastTick = now;
+        if (late >= STALL_THRESHOLD_MS) {
+            stallTotal += late;
+            stallMax = qMax(stallMax, late);
+        }
+    });
+
+    QTextStream out(stdout);
+    int failures = 0;
+
+    /* All the assets at once, compared with downloading them in turn */
+    auto runQueue = [&](int connections) {
+        ZDownloadQueue queue;
+        queue.setMaxConnections(connections);
+        queue.setRateLimit(parseSize(parser.value("rate-limit")));
+        queue.setWriteStrategy(writeStrategy);
+
+        qint64 bytes = 0;
+        for (int i = 0; i < sizes.size(); ++i) {
+            QVariantMap profile;
+            profile["browser_download_url"] =
+                QString("http://127.0.0.1:%1/asset/%2.bin")
+                    .arg(port)
+                    .arg(sizes.at(i));
+            profile["file_name"] = QString("queue-%1.bin").arg(i);
+            profile["size"] = sizes.at(i);
+            if (parser.isSet("verify"))
+                profile["sha256"] = ZBenchServer::sha256(sizes.at(i)).toHex();
+            queue.add(profile, dir.path());
+            bytes += sizes.at(i);
+        }
+
+        QElapsedTimer wall;
+        wall.start();
+
+        QEventLoop loop;
+        QObject::connect(&queue, &ZDownloadQueue::finished, &loop,
+                         &QEventLoop::quit);
+        queue.start();
+        loop.exec();
+
+        double seconds = wall.nsecsElapsed() / 1e9;
+
+        QJsonObject result;
+        result["mode"] = connections > 1 ? "queue" : "sequential";
+        result["connections"] = connections;
+        result["files"] = int(sizes.size());
+        result["bytes"] = bytes;
+        result["latency_ms"] = options.latency;
+        result["bandwidth"] = options.bandwidth;
+        result["ok"] = queue.failedCount() == 0;
+        result["failed"] = queue.failedCount();
+        result["seconds"] = seconds;
+        result["mb_per_s"] = bytes / 1048576.0 / seconds;
+
+        out << QJsonDocument(result).toJson(QJsonDocument::Compact)
+            << Qt::endl;
+
+        failures += queue.failedCount();
+        for (int id : queue.ids())
+            QFile::remove(queue.filePath(id));
+    };
+
+    if (parser.isSet("queue")) {
+        runQueue(qMax(1, parser.value("queue").toInt()));
+        runQueue(1);
+
+        serverThread.quit();
+        serverThread.wait();
+        return failures > 0 ? 1 : 0;
+    }
+
+    for (qint64 size : std::as_const(sizes)) {
+        QMap<int, double> speeds;
+        for (int segments : std::as_const(segmentCounts)) {
+            client.setDownloadSegmentCount(segments);
+            for (int run = 0; run < qMax(1, parser.value("repeat").toInt());
+                 ++run) {
+                QVariantMap profile;
+                profile["browser_download_url"] =
+                    QString("http://127.0.0.1:%1/asset/%2.bin")
+                        .arg(port)
+                        .arg(size);
+                profile["file_name"] = QString("bench-%1.bin").arg(size);
+                if (parser.isSet("verify"))
+                    profile["sha256"] = ZBenchServer::sha256(size).toHex();
+
+                qint64 ioReads = procValue("/proc/self/io", "syscr");
+                qint64 ioWrites = procValue("/proc/self/io", "syscw");
+                double cpu = cpuSeconds(false);
+                double cpuServer = serverCpu();
+                resetPeakRss();
+                qint64 rssBefore = procValue("/proc/self/status", "VmRSS");
+                QMetaObject::invokeMethod(server, &ZBenchServer::resetStats,
+                                          Qt::BlockingQueuedConnection);
+
+                stallTotal = 0;
+                stallMax = 0;
+                lastTick = 0;
+                tickClock.start();
+                ticker.start();
+
+                QElapsedTimer wall;
+                wall.start();
+
+                QEventLoop loop;
+                QString error;
+                QObject::connect(&client, &ZUpdateClient::downloadFinished,
+                                 &loop, &QEventLoop::quit);
+                QObject::connect(&client, &ZUpdateClient::downloadFailed,
+                                 &loop, [&](const QString &message) {
+                                     error = message;
+                                     loop.quit();
+                                 });
+                client.download(profile, dir.path());
+                loop.exec();
+
+                double seconds = wall.nsecsElapsed() / 1e9;
+                ticker.stop();
+
+                /* The server runs in the same process, leave its share out */
+                double serverSeconds = serverCpu() - cpuServer;
+                double clientSeconds = cpuSeconds(false) - cpu - serverSeconds;
+                double gb = size / 1073741824.0;
+
+                QJsonObject result;
+                result["size"] = size;
+                result["run"] = run;
+                result["segments"] = client.downloadSegmentCount();
+                result["chunk"] = options.chunkSize;
+                result["latency_ms"] = options.latency;
+                result["bandwidth"] = options.bandwidth;
+                result["write_buffer"] = writeStrategy.bufferSize;
+                result["prealloc"] = writeStrategy.preallocate;
+                result["sync"] = writeStrategy.sync;
+                result["ok"] = error.isEmpty();
+                if (!error.isEmpty())
+                    result["error"] = error;
+                result["seconds"] = seconds;
+                result["mb_per_s"] = size / 1048576.0 / seconds;
+                if (error.isEmpty())
+                    speeds[segments] = qMax(speeds.value(segments),
+                                            size / 1048576.0 / seconds);
+                result["cpu_s"] = clientSeconds;
+                result["cpu_s_per_gb"] = gb > 0 ? clientSeconds / gb : 0;
+                result["server_cpu_s"] = serverSeconds;
+                qint64 peakRss = peakRssKb();
+                result["peak_rss_kb"] = peakRss;
+                if (ioReads >= 0) {
+                    result["read_syscalls"] =
+                        procValue("/proc/self/io", "syscr") - ioReads;
+                    result["write_syscalls"] =
+                        procValue("/proc/self/io", "syscw") - ioWrites;
+                }
+                result["main_stall_ms"] = stallTotal;
+                result["main_stall_max_ms"] = stallMax;
+
+                /* Everything but the progress runs in the transfer thread,
+                 * the main thread must stay free to repaint */
+                bool responsive = stallMax <= mainStallLimit;
+                result["main_responsive"] = responsive;
+
+                /* The stalled response must be dropped after the timeout and
+                 * resumed where its data stopped */
+                bool recovered = true;
+                if (options.stallAt >= 0) {
+                    ZBenchServer::Stats stats = serverStats();
+                    recovered = stats.stalls == 1 &&
+                                stats.resumedAt == options.stallAt &&
+                                stats.stallMs >= ZTransfer::StallTimeout &&
+                                stats.stallMs <= ZTransfer::StallTimeout +
+                                                     ZTransfer::RetryDelay +
+                                                     STALL_LEEWAY_MS;
+                    result["stall_at"] = options.stallAt;
+                    result["resumed_at"] = stats.resumedAt;
+                    result["stall_recovery_ms"] = stats.stallMs;
+                    result["recovered"] = recovered;
+                }
+
+                /* The probe must be dropped as soon as the full response
+                 * starts, not after the asset was received once already */
+                bool probed = true;
+                if (options.ignoreRanges) {
+                    ZBenchServer::Stats stats = serverStats();
+                    probed = stats.bytesSent - size <= RANGE_PROBE_SLACK;
+                    result["bytes_sent"] = stats.bytesSent;
+                    result["probe_bounded"] = probed;
+                }
+
+                /* Without /proc the growth can't be measured, which fails the
+                 * check rather than passing it unseen */
+                bool bounded = true;
+                if (parser.isSet("rss-limit")) {
+                    qint64 growth = rssBefore >= 0 && peakRss >= 0
+                                        ? peakRss - rssBefore
+                                        : -1;
+                    qint64 limit = parseSize(parser.value("rss-limit"));
+                    bounded = growth >= 0 && growth * 1024 <= limit;
+                    result["rss_growth_kb"] = growth;
+                    result["rss_bounded"] = bounded;
+                }
+
+                /* The bucket starts full, so the first quarter second worth
+                 * of data arrives at full speed */
+                bool paced = true;
+                qint64 rate = client.downloadRateLimit();
+                if (rate > 0 && options.stallAt < 0 && error.isEmpty() &&
+                    size >= rate * RATE_MIN_SECONDS) {
+                    double achieved =
+                        (size - rate * RATE_BURST_SECONDS) / seconds;
+                    paced = qAbs(achieved / rate - 1) <= RATE_TOLERANCE;
+                    result["rate_limit"] = rate;
+                    result["achieved_rate"] = achieved;
+                    result["rate_paced"] = paced;
+                }
+
+                out << QJsonDocument(result).toJson(QJsonDocument::Compact)
+                    << Qt::endl;
+
+                if (!error.isEmpty() || !responsive || !recovered || !probed ||
+                    !bounded || !paced)
+                    ++failures;
+
+                QFile::remove(dir.filePath(profile["file_name"].toString()));
+            }
+        }
+
+        /* Each connection is shaped to the server bandwidth, so more of
+         * them must pay off. Without a limit there is nothing to compare
+         * against, the loopback link is not the bottleneck, and rate limited
+         * downloads use a single connection anyway. */
+        if (options.bandwidth > 0 && client.downloadRateLimit() == 0 &&
+            speeds.size() > 1 && speeds.contains(1)) {
+            int most = speeds.lastKey();
+            double speedup = speeds.value(most) / speeds.value(1);
+            bool scaled = speedup >= most * SEGMENT_MIN_EFFICIENCY;
+
+            QJsonObject result;
+            result["mode"] = "segments";
+            result["size"] = size;
+            result["segments"] = most;
+            result["bandwidth"] = options.bandwidth;
+            result["speedup"] = speedup;
+            result["ok"] = scaled;
+            out << QJsonDocument(result).toJson(QJsonDocument::Compact)
+                << Qt::endl;
+
+            if (!scaled)
+                ++failures;
+        }
+    }
+
+    serverThread.quit();
+    serverThread.wait();
+    return failures > 0 ? 1 : 0;
+}
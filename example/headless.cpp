@@ -0,0 +1,52 @@
+#include "../src/ZUpdateClient.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QTextStream>
+
+#ifndef APP_VERSION
+#define APP_VERSION "0.1"
+#endif
+
+// Checks for an update without any user interface and downloads it when
+// started with --download
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    bool download = a.arguments().contains("--download");
+
+    ZUpdateClient client("uncor3/libtest", APP_VERSION);
+    QTextStream out(stdout);
+
+    QObject::connect(&client, &ZUpdateClient::noUpdateAvailable, [&]() {
+        out << "No update available" << Qt::endl;
+        a.exit(0);
+    });
+    QObject::connect(&client, &ZUpdateClient::checkFailed,
+                     [&](const QString &error) {
+                         out << "Check failed: " << error << Qt::endl;
+                         a.exit(1);
+                     });
+    QObject::connect(&client, &ZUpdateClient::updateAvailable,
+                     [&](const QVariantMap &profile) {
+                         out << "Update available: "
+                             << profile.value("tag_name").toString()
+                             << Qt::endl;
+                         if (!download)
+                             return a.exit(0);
+                         client.download(profile, QDir::tempPath());
+                     });
+    QObject::connect(&client, &ZUpdateClient::downloadFinished,
+                     [&](const QString &filePath) {
+                         out << "Downloaded " << filePath << Qt::endl;
+                         a.exit(0);
+                     });
+    QObject::connect(&client, &ZUpdateClient::downloadFailed,
+                     [&](const QString &error) {
+                         out << "Download failed: " << error << Qt::endl;
+                         a.exit(1);
+                     });
+
+    client.checkForUpdates();
+    return a.exec();
+}
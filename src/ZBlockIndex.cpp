@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZBlockIndex.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QFuture>
+#include <QList>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+/* Size of the bitmap used to reject windows before the sorted lookup */
+static const int FILTER_BITS = 20;
+
+/* Don't bother threads with less than this much of the seed file */
+static const qint64 MIN_SCAN_CHUNK = 4 * 1024 * 1024;
+
+static quint32 filterHash(quint32 rsum)
+{
+    return (rsum * 2654435761u) >> (32 - FILTER_BITS);
+}
+
+ZBlockIndex::ZBlockIndex()
+    : m_length(0), m_blockSize(0), m_seqMatches(1), m_rsumBytes(4),
+      m_checksumBytes(16), m_rsumMask(0xffffffff)
+{
+}
+
+/**
+ * Reads a zsync control file: a block of "Key: value" header lines, an
+ * empty line, and the checksums of every block
+ */
+bool ZBlockIndex::parse(const QByteArray &data)
+{
+    *this = ZBlockIndex();
+
+    int headerEnd = data.indexOf("\n\n");
+    if (headerEnd < 0)
+        return setError(QStringLiteral("Missing block index header"));
+
+    const QList<QByteArray> lines = data.left(headerEnd).split('\n');
+    for (const QByteArray &line : lines) {
+        int colon = line.indexOf(':');
+        if (colon < 0)
+            continue;
+
+        QByteArray key = line.left(colon).trimmed();
+        QByteArray value = line.mid(colon + 1).trimmed();
+
+        if (key == "Filename") {
+            m_fileName = QString::fromUtf8(value);
+        } else if (key == "Blocksize") {
+            m_blockSize = value.toInt();
+        } else if (key == "Length") {
+            m_length = value.toLongLong();
+        } else if (key == "Hash-Lengths") {
+            QList<QByteArray> lengths = value.split(',');
+            if (lengths.size() != 3)
+                return setError(QStringLiteral("Invalid Hash-Lengths"));
+            m_seqMatches = lengths.at(0).toInt();
+            m_rsumBytes = lengths.at(1).toInt();
+            m_checksumBytes = lengths.at(2).toInt();
+        } else if (key == "SHA-1") {
+            m_sha1 = QByteArray::fromHex(value);
+        } else if (key == "Z-Map2" || key == "Z-URL") {
+            return setError(QStringLiteral("Compressed targets are not "
+                                           "supported"));
+        }
+    }
+
+    if (m_blockSize <= 0 || m_blockSize > 1024 * 1024 || m_length <= 0 ||
+        m_seqMatches < 1 || m_seqMatches > 2 || m_rsumBytes < 1 ||
+        m_rsumBytes > 4 || m_checksumBytes < 3 || m_checksumBytes > 16 ||
+        m_sha1.size() != 20)
+        return setError(QStringLiteral("Invalid block index header"));
+
+    qint64 blocks = (m_length + m_blockSize - 1) / m_blockSize;
+    qint64 entry = m_rsumBytes + m_checksumBytes;
+    qint64 offset = headerEnd + 2;
+    if (data.size() - offset < blocks * entry)
+        return setError(QStringLiteral("Truncated block index"));
+
+    /* The weak checksum is stored big endian, truncated to its last bytes */
+    m_rsumMask = m_rsumBytes == 4 ? 0xffffffff
+                                  : (quint32(1) << (8 * m_rsumBytes)) - 1;
+
+    const uchar *p =
+        reinterpret_cast<const uchar *>(data.constData()) + offset;
+    m_rsums.resize(blocks);
+    m_checksums.reserve(blocks * m_checksumBytes);
+    for (qint64 i = 0; i < blocks; ++i) {
+        quint32 rsum = 0;
+        for (int j = 0; j < m_rsumBytes; ++j)
+            rsum = (rsum << 8) | *p++;
+
+        m_rsums[i] = rsum;
+        m_checksums.append(reinterpret_cast<const char *>(p), m_checksumBytes);
+        p += m_checksumBytes;
+    }
+
+    m_sortedBlocks.resize(blocks);
+    for (int i = 0; i < m_sortedBlocks.size(); ++i)
+        m_sortedBlocks[i] = i;
+    std::sort(m_sortedBlocks.begin(), m_sortedBlocks.end(),
+              [this](int a, int b) { return m_rsums[a] < m_rsums[b]; });
+
+    m_sortedRsums.resize(blocks);
+    m_filter.fill(0, (1 << FILTER_BITS) / 64);
+    for (int i = 0; i < m_sortedBlocks.size(); ++i) {
+        quint32 rsum = m_rsums[m_sortedBlocks[i]];
+        quint32 h = filterHash(rsum);
+        m_sortedRsums[i] = rsum;
+        m_filter[h >> 6] |= quint64(1) << (h & 63);
+    }
+
+    return true;
+}
+
+/**
+ * Looks for the blocks of the target file in \a seedPath, using up to
+ * \a threads threads. Returns, for every block, its offset in the seed file
+ * or -1 if it has to be downloaded.
+ */
+QVector<qint64> ZBlockIndex::scan(const QString &seedPath, int threads) const
+{
+    QVector<qint64> offsets(blockCount(), -1);
+
+    QFile file(seedPath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < m_blockSize) {
+        qWarning() << "ZBlockIndex: cannot read" << seedPath;
+        return offsets;
+    }
+
+    qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    if (!data) {
+        qWarning() << "ZBlockIndex: cannot map" << seedPath;
+        return offsets;
+    }
+
+    /* Every thread slides the window over its own share of start
+     * positions, reading at most a block past the end of it */
+    qint64 positions = size - m_blockSize + 1;
+    int count = int(qBound<qint64>(1, positions / MIN_SCAN_CHUNK + 1,
+                                   qMax(1, threads)));
+    qint64 step = (positions + count - 1) / count;
+
+    QVector<QVector<qint64>> found(count);
+    QList<QFuture<void>> futures;
+    for (int i = 0; i < count; ++i) {
+        Range range = {i * step, qMin(positions, (i + 1) * step)};
+        found[i].fill(-1, blockCount());
+        futures.append(QtConcurrent::run([this, data, size, range, &found,
+                                          i]() {
+            scanRange(data, size, range, found[i]);
+        }));
+    }
+
+    for (QFuture<void> &future : futures)
+        future.waitForFinished();
+
+    for (const QVector<qint64> &part : std::as_const(found)) {
+        for (int block = 0; block < offsets.size(); ++block) {
+            if (offsets[block] < 0)
+                offsets[block] = part[block];
+        }
+    }
+
+    file.unmap(const_cast<uchar *>(data));
+    return offsets;
+}
+
+void ZBlockIndex::scanRange(const uchar *data, qint64 size, Range range,
+                            QVector<qint64> &offsets) const
+{
+    const quint32 bs = quint32(m_blockSize);
+    quint32 a = 0;
+    quint32 b = 0;
+
+    /* Plain loops over bytes with wide accumulators, the compiler
+     * vectorizes these */
+    auto reset = [&](qint64 pos) {
+        a = 0;
+        b = 0;
+        for (quint32 i = 0; i < bs; ++i) {
+            quint32 c = data[pos + i];
+            a += c;
+            b += (bs - i) * c;
+        }
+    };
+
+    qint64 pos = range.begin;
+    reset(pos);
+
+    QByteArray md4;
+    while (pos < range.end) {
+        quint32 rsum = (((a & 0xffff) << 16) | (b & 0xffff)) & m_rsumMask;
+
+        if (mayContain(rsum)) {
+            auto first = std::lower_bound(m_sortedRsums.cbegin(),
+                                          m_sortedRsums.cend(), rsum);
+
+            md4.clear();
+            bool matched = false;
+            for (auto it = first; it != m_sortedRsums.cend() && *it == rsum;
+                 ++it) {
+                int block = m_sortedBlocks[it - m_sortedRsums.cbegin()];
+                if (matchesAt(data, size, pos, block, md4)) {
+                    if (offsets[block] < 0)
+                        offsets[block] = pos;
+                    matched = true;
+                }
+            }
+
+            /* A matching block can't overlap another one, skip over it */
+            if (matched) {
+                pos += bs;
+                if (pos >= range.end)
+                    break;
+                reset(pos);
+                continue;
+            }
+        }
+
+        if (pos + m_blockSize >= size)
+            break;
+
+        /* Roll the window one byte forward */
+        quint32 out = data[pos];
+        quint32 in = data[pos + bs];
+        a += in - out;
+        b += a - bs * out;
+        ++pos;
+    }
+}
+
+bool ZBlockIndex::matchesAt(const uchar *data, qint64 size, qint64 pos,
+                            int block, QByteArray &md4) const
+{
+    if (md4.isEmpty())
+        md4 = blockMd4(data, size, pos);
+
+    const char *expected =
+        m_checksums.constData() + qint64(block) * m_checksumBytes;
+    if (memcmp(md4.constData(), expected, size_t(m_checksumBytes)) != 0)
+        return false;
+
+    /* Indexes with short checksums rely on runs of matching blocks */
+    if (m_seqMatches < 2 || block + 1 >= blockCount())
+        return true;
+
+    qint64 next = pos + m_blockSize;
+    if (next >= size || blockRsum(data, size, next) != m_rsums[block + 1])
+        return false;
+
+    expected += m_checksumBytes;
+    QByteArray nextMd4 = blockMd4(data, size, next);
+    return memcmp(nextMd4.constData(), expected, size_t(m_checksumBytes)) == 0;
+}
+
+/**
+ * Weak checksum of the block at \a pos, past the end of the data counts as
+ * zeros just like the padding of the last block of the target
+ */
+quint32 ZBlockIndex::blockRsum(const uchar *data, qint64 size,
+                               qint64 pos) const
+{
+    const quint32 bs = quint32(m_blockSize);
+    quint32 n = quint32(qMin<qint64>(bs, size - pos));
+    quint32 a = 0;
+    quint32 b = 0;
+    for (quint32 i = 0; i < n; ++i) {
+        quint32 c = data[pos + i];
+        a += c;
+        b += (bs - i) * c;
+    }
+
+    return (((a & 0xffff) << 16) | (b & 0xffff)) & m_rsumMask;
+}
+
+QByteArray ZBlockIndex::blockMd4(const uchar *data, qint64 size,
+                                 qint64 pos) const
+{
+    qint64 n = qMin<qint64>(m_blockSize, size - pos);
+
+    QCryptographicHash hash(QCryptographicHash::Md4);
+    hash.addData(QByteArrayView(reinterpret_cast<const char *>(data + pos), n));
+    if (n < m_blockSize)
+        hash.addData(QByteArray(m_blockSize - n, '\0'));
+
+    return hash.result();
+}
+
+bool ZBlockIndex::mayContain(quint32 rsum) const
+{
+    quint32 h = filterHash(rsum);
+    return m_filter[h >> 6] & (quint64(1) << (h & 63));
+}
+
+bool ZBlockIndex::setError(const QString &error)
+{
+    m_error = error;
+    return false;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZBLOCK_INDEX_H
+#define ZBLOCK_INDEX_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/**
+ * Block checksum index of a file, in the zsync control file format used by
+ * the AppImage tooling (appimagetool writes one next to every release).
+ *
+ * The index lists a weak rolling checksum and a truncated MD4 for every
+ * block of the target file. scan() slides a window over a local seed file
+ * (usually the running AppImage) and reports where each target block can
+ * be found in it, so only the remaining blocks have to be downloaded.
+ */
+class ZBlockIndex
+{
+public:
+    ZBlockIndex();
+
+    bool parse(const QByteArray &data);
+    QString errorString() const { return m_error; }
+
+    QString fileName() const { return m_fileName; }
+    qint64 length() const { return m_length; }
+    int blockSize() const { return m_blockSize; }
+    int blockCount() const { return m_rsums.size(); }
+    QByteArray sha1() const { return m_sha1; }
+
+    QVector<qint64> scan(const QString &seedPath, int threads) const;
+
+private:
+    struct Range {
+        qint64 begin;
+        qint64 end;
+    };
+
+    void scanRange(const uchar *data, qint64 size, Range range,
+                   QVector<qint64> &offsets) const;
+    bool matchesAt(const uchar *data, qint64 size, qint64 pos, int block,
+                   QByteArray &md4) const;
+    quint32 blockRsum(const uchar *data, qint64 size, qint64 pos) const;
+    QByteArray blockMd4(const uchar *data, qint64 size, qint64 pos) const;
+    bool mayContain(quint32 rsum) const;
+    bool setError(const QString &error);
+
+    QString m_error;
+    QString m_fileName;
+    qint64 m_length;
+    int m_blockSize;
+    int m_seqMatches;
+    int m_rsumBytes;
+    int m_checksumBytes;
+    quint32 m_rsumMask;
+    QByteArray m_sha1;
+
+    /* Per block checksums, plus the blocks sorted by rolling checksum and a
+     * bitmap that rejects most windows without a lookup */
+    QVector<quint32> m_rsums;
+    QByteArray m_checksums;
+    QVector<quint32> m_sortedRsums;
+    QVector<int> m_sortedBlocks;
+    QVector<quint64> m_filter;
+};
+
+#endif
@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZBlockUpdate.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QThread>
+#include <QtConcurrent>
+
+/* Limits of a single multi-range request, the response is kept in memory */
+static const int MAX_RANGES_PER_REQUEST = 32;
+static const qint64 MAX_REQUEST_SIZE = 16 * 1024 * 1024;
+
+ZBlockUpdate::ZBlockUpdate(QNetworkAccessManager *manager, QObject *parent)
+    : QObject(parent), m_manager(manager), m_reply(nullptr), m_scan(this),
+      m_running(false), m_reused(0), m_fetched(0)
+{
+    connect(&m_scan, &QFutureWatcher<QVector<qint64>>::finished, this,
+            &ZBlockUpdate::scanFinished);
+}
+
+ZBlockUpdate::~ZBlockUpdate()
+{
+    abort();
+    m_scan.waitForFinished();
+}
+
+/**
+ * Builds the resource described by \a request in \a filePath, reusing the
+ * blocks of \a seedPath listed in the block index at \a indexUrl
+ */
+void ZBlockUpdate::start(const QNetworkRequest &request, const QUrl &indexUrl,
+                         const QString &seedPath, const QString &filePath)
+{
+    abort();
+
+    m_request = request;
+    m_seedPath = seedPath;
+    m_file.setFileName(filePath);
+    m_missing.clear();
+    m_running = true;
+    m_reused = 0;
+    m_fetched = 0;
+    m_sha256.clear();
+
+    QNetworkRequest index(request);
+    index.setUrl(indexUrl);
+
+    m_reply = m_manager->get(index);
+    connect(m_reply, &QNetworkReply::finished, this,
+            &ZBlockUpdate::indexFinished);
+}
+
+/**
+ * Cancels the update, the (partial) file is left on disk
+ */
+void ZBlockUpdate::abort()
+{
+    if (!m_running)
+        return;
+
+    m_running = false;
+    clear();
+}
+
+void ZBlockUpdate::indexFinished()
+{
+    QNetworkReply *reply = m_reply;
+    m_reply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+
+    if (!m_index.parse(reply->readAll())) {
+        fail(m_index.errorString());
+        return;
+    }
+
+    /* Scanning reads the whole seed file, keep it off the transfer thread */
+    ZBlockIndex index = m_index;
+    QString seed = m_seedPath;
+    m_scan.setFuture(QtConcurrent::run([index, seed]() {
+        return index.scan(seed, QThread::idealThreadCount());
+    }));
+}
+
+void ZBlockUpdate::scanFinished()
+{
+    if (!m_running)
+        return;
+
+    if (!copyBlocks(m_scan.result()))
+        return;
+
+    qint64 length = m_index.length();
+    qDebug() << "ZBlockUpdate: reusing" << m_reused << "of" << length
+             << "bytes," << qRound(100.0 * m_reused / length)
+             << "percent, from" << m_seedPath;
+
+    emit downloadProgress(m_reused, length);
+
+    if (m_missing.isEmpty())
+        verify();
+    else
+        requestRanges();
+}
+
+/**
+ * Creates the target file, copies the blocks found in the seed file into it
+ * and collects the byte ranges that are still missing
+ */
+bool ZBlockUpdate::copyBlocks(const QVector<qint64> &offsets)
+{
+    QFile seed(m_seedPath);
+    const uchar *data = nullptr;
+    if (seed.open(QIODevice::ReadOnly))
+        data = seed.map(0, seed.size());
+
+    if (!data) {
+        fail(seed.errorString());
+        return false;
+    }
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        !m_file.resize(m_index.length())) {
+        fail(m_file.errorString());
+        return false;
+    }
+
+    qint64 length = m_index.length();
+    qint64 blockSize = m_index.blockSize();
+    for (int block = 0; block < offsets.size(); ++block) {
+        qint64 begin = block * blockSize;
+        qint64 end = qMin(begin + blockSize, length);
+
+        if (offsets[block] < 0) {
+            /* Merge with the previous missing range when adjacent */
+            if (!m_missing.isEmpty() && m_missing.last().end == begin)
+                m_missing.last().end = end;
+            else
+                m_missing.append({begin, end});
+            continue;
+        }
+
+        if (!writePart(begin,
+                       reinterpret_cast<const char *>(data + offsets[block]),
+                       end - begin))
+            return false;
+
+        m_reused += end - begin;
+    }
+
+    return true;
+}
+
+/**
+ * Requests the next batch of missing ranges in a single request
+ */
+void ZBlockUpdate::requestRanges()
+{
+    QByteArray ranges;
+    qint64 size = 0;
+    int count = 0;
+
+    while (!m_missing.isEmpty() && count < MAX_RANGES_PER_REQUEST &&
+           size < MAX_REQUEST_SIZE) {
+        Range &range = m_missing.first();
+        qint64 end = qMin(range.end, range.begin + MAX_REQUEST_SIZE - size);
+
+        if (!ranges.isEmpty())
+            ranges += ',';
+        ranges += QByteArray::number(range.begin) + '-' +
+                  QByteArray::number(end - 1);
+
+        size += end - range.begin;
+        ++count;
+
+        if (end == range.end)
+            m_missing.removeFirst();
+        else
+            range.begin = end;
+    }
+
+    QNetworkRequest request(m_request);
+    request.setRawHeader("Range", "bytes=" + ranges);
+
+    m_reply = m_manager->get(request);
+    connect(m_reply, &QNetworkReply::metaDataChanged, this,
+            &ZBlockUpdate::rangesMetaData);
+    connect(m_reply, &QNetworkReply::downloadProgress, this,
+            &ZBlockUpdate::rangesProgress);
+    connect(m_reply, &QNetworkReply::finished, this,
+            &ZBlockUpdate::rangesFinished);
+}
+
+void ZBlockUpdate::rangesMetaData()
+{
+    /* A 200 is the whole file, which is what we are trying to avoid */
+    int status =
+        m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 200)
+        fail(tr("Server ignored range request"));
+}
+
+void ZBlockUpdate::rangesProgress(qint64 received, qint64 total)
+{
+    Q_UNUSED(total);
+    emit downloadProgress(m_reused + m_fetched + received, m_index.length());
+}
+
+void ZBlockUpdate::rangesFinished()
+{
+    QNetworkReply *reply = m_reply;
+    m_reply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+
+    int status =
+        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 206) {
+        fail(tr("Server ignored range request"));
+        return;
+    }
+
+    if (!writeParts(reply))
+        return;
+
+    emit downloadProgress(m_reused + m_fetched, m_index.length());
+
+    if (m_missing.isEmpty())
+        verify();
+    else
+        requestRanges();
+}
+
+/**
+ * Writes the body of a range response to the file. Servers answer a single
+ * range with a plain body and several with a multipart/byteranges body, in
+ * which every part carries its own Content-Range header.
+ */
+bool ZBlockUpdate::writeParts(QNetworkReply *reply)
+{
+    QByteArray body = reply->readAll();
+
+    auto parseRange = [](const QByteArray &value, qint64 &begin,
+                         qint64 &end) {
+        /* bytes <begin>-<end>/<total> */
+        QByteArray range = value.trimmed();
+        int dash = range.indexOf('-');
+        int slash = range.indexOf('/');
+        if (!range.startsWith("bytes ") || dash < 0 || slash < dash)
+            return false;
+
+        bool ok1 = false;
+        bool ok2 = false;
+        begin = range.mid(6, dash - 6).toLongLong(&ok1);
+        end = range.mid(dash + 1, slash - dash - 1).toLongLong(&ok2) + 1;
+        return ok1 && ok2 && end > begin;
+    };
+
+    qint64 begin = 0;
+    qint64 end = 0;
+
+    QByteArray type = reply->header(QNetworkRequest::ContentTypeHeader)
+                          .toByteArray()
+                          .toLower();
+    if (!type.startsWith("multipart/byteranges")) {
+        if (!parseRange(reply->rawHeader("Content-Range"), begin, end) ||
+            end - begin != body.size()) {
+            fail(tr("Invalid range response"));
+            return false;
+        }
+
+        if (!writePart(begin, body.constData(), body.size()))
+            return false;
+
+        m_fetched += body.size();
+        return true;
+    }
+
+    /* We don't need the boundary, the part headers tell us how long the
+     * data that follows them is */
+    qint64 pos = 0;
+    forever {
+        qint64 headerEnd = body.indexOf("\r\n\r\n", pos);
+        if (headerEnd < 0)
+            break;
+
+        bool found = false;
+        const QList<QByteArray> lines =
+            body.mid(pos, headerEnd - pos).split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.toLower().startsWith("content-range:")) {
+                found = parseRange(line.mid(14), begin, end);
+                break;
+            }
+        }
+
+        if (!found)
+            break;
+
+        qint64 dataStart = headerEnd + 4;
+        if (dataStart + (end - begin) > body.size()) {
+            fail(tr("Truncated range response"));
+            return false;
+        }
+
+        if (!writePart(begin, body.constData() + dataStart, end - begin))
+            return false;
+
+        m_fetched += end - begin;
+        pos = dataStart + (end - begin);
+    }
+
+    return true;
+}
+
+bool ZBlockUpdate::writePart(qint64 begin, const char *data, qint64 size)
+{
+    if (begin < 0 || begin + size > m_index.length()) {
+        fail(tr("Range outside of the file"));
+        return false;
+    }
+
+    if (!m_file.seek(begin) || m_file.write(data, size) != size) {
+        fail(m_file.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Checks the assembled file against the SHA-1 from the index. The SHA-256
+ * used for the regular download verification is computed in the same pass.
+ */
+void ZBlockUpdate::verify()
+{
+    m_file.close();
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        fail(m_file.errorString());
+        return;
+    }
+
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    QCryptographicHash sha256(QCryptographicHash::Sha256);
+    QByteArray buffer(256 * 1024, Qt::Uninitialized);
+    forever {
+        qint64 read = m_file.read(buffer.data(), buffer.size());
+        if (read <= 0)
+            break;
+
+        QByteArrayView chunk(buffer.constData(), read);
+        sha1.addData(chunk);
+        sha256.addData(chunk);
+    }
+    m_file.close();
+
+    if (sha1.result() != m_index.sha1()) {
+        fail(tr("Assembled file does not match the block index"));
+        return;
+    }
+
+    qDebug() << "ZBlockUpdate: downloaded" << m_fetched << "bytes, reused"
+             << m_reused << "bytes";
+
+    m_sha256 = sha256.result();
+    m_running = false;
+    emit finished();
+}
+
+void ZBlockUpdate::fail(const QString &error)
+{
+    if (!m_running)
+        return;
+
+    qWarning() << "ZBlockUpdate:" << error;
+    m_running = false;
+    clear();
+    emit failed(error);
+}
+
+void ZBlockUpdate::clear()
+{
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+        m_reply = nullptr;
+    }
+
+    m_file.close();
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZBLOCK_UPDATE_H
+#define ZBLOCK_UPDATE_H
+
+#include "ZBlockIndex.h"
+#include <QByteArray>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QList>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QVector>
+
+class QNetworkReply;
+class QNetworkAccessManager;
+
+/**
+ * Rebuilds a file from a local copy of a previous version.
+ *
+ * The block index published next to the file is downloaded and the seed
+ * file is scanned for blocks that did not change. Those are copied into the
+ * target file, the missing ones are fetched with multi-range requests, and
+ * the result is checked against the SHA-1 in the index.
+ *
+ * Any failure is reported through failed(), the caller is expected to fall
+ * back to a regular download.
+ */
+class ZBlockUpdate : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void downloadProgress(qint64 received, qint64 total);
+    void finished();
+    void failed(const QString &error);
+
+public:
+    explicit ZBlockUpdate(QNetworkAccessManager *manager,
+                          QObject *parent = nullptr);
+    ~ZBlockUpdate();
+
+    bool isRunning() const { return m_running; }
+    qint64 reusedBytes() const { return m_reused; }
+    QByteArray sha256() const { return m_sha256; }
+
+public slots:
+    void start(const QNetworkRequest &request, const QUrl &indexUrl,
+               const QString &seedPath, const QString &filePath);
+    void abort();
+
+private slots:
+    void indexFinished();
+    void scanFinished();
+    void rangesMetaData();
+    void rangesFinished();
+    void rangesProgress(qint64 received, qint64 total);
+
+private:
+    struct Range {
+        qint64 begin;
+        qint64 end;
+    };
+
+    bool copyBlocks(const QVector<qint64> &offsets);
+    void requestRanges();
+    bool writeParts(QNetworkReply *reply);
+    bool writePart(qint64 begin, const char *data, qint64 size);
+    void verify();
+    void fail(const QString &error);
+    void clear();
+
+    QNetworkAccessManager *m_manager;
+    QNetworkRequest m_request;
+    QNetworkReply *m_reply;
+    QFutureWatcher<QVector<qint64>> m_scan;
+
+    ZBlockIndex m_index;
+    QString m_seedPath;
+    QFile m_file;
+    QList<Range> m_missing;
+
+    bool m_running;
+    qint64 m_reused;
+    qint64 m_fetched;
+    QByteArray m_sha256;
+};
+
+#endif
@@ -0,0 +1,562 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZContentDecoder.h"
+#include <QCoreApplication>
+#include <QList>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QThread>
+
+#ifdef ZUPDATER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef ZUPDATER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef ZUPDATER_HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+#ifdef ZUPDATER_HAVE_LZMA
+#include <lzma.h>
+
+/* lzma_stream is an anonymous struct, it can't be declared ahead */
+struct ZLzmaStream {
+    lzma_stream stream = LZMA_STREAM_INIT;
+};
+
+/* Memory the multithreaded xz decoder may use before it falls back to a
+ * single thread */
+static const quint64 LZMA_THREADING_MEMLIMIT = 512 * 1024 * 1024;
+#endif
+
+/* Decoded data is appended to the output in steps of this size */
+static const qint64 OUTPUT_CHUNK = 64 * 1024;
+
+static QString translate(const char *text)
+{
+    return QCoreApplication::translate("ZContentDecoder", text);
+}
+
+ZContentDecoder::ZContentDecoder()
+    : m_encoding(Identity), m_started(false), m_done(false),
+      m_zlib(nullptr), m_zstd(nullptr), m_brotli(nullptr), m_lzma(nullptr),
+      m_bytesIn(0), m_bytesOut(0)
+{
+}
+
+ZContentDecoder::~ZContentDecoder() { reset(); }
+
+/**
+ * Returns true if this build can decode \a encoding
+ */
+bool ZContentDecoder::isSupported(Encoding encoding)
+{
+    switch (encoding) {
+    case Identity:
+        return true;
+#ifdef ZUPDATER_HAVE_ZLIB
+    case Gzip:
+    case Deflate:
+        return true;
+#endif
+#ifdef ZUPDATER_HAVE_BROTLI
+    case Brotli:
+        return true;
+#endif
+#ifdef ZUPDATER_HAVE_ZSTD
+    case Zstd:
+        return true;
+#endif
+#ifdef ZUPDATER_HAVE_LZMA
+    case Xz:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * Returns the Accept-Encoding header offered by negotiate(), best first. It
+ * is empty without zlib: gzip is the one encoding every server speaks, and
+ * Qt handles it on its own.
+ */
+QByteArray ZContentDecoder::acceptEncoding()
+{
+    if (!isSupported(Gzip))
+        return QByteArray();
+
+    QList<QByteArray> encodings;
+    for (Encoding encoding : {Zstd, Brotli, Gzip, Deflate}) {
+        if (isSupported(encoding))
+            encodings.append(name(encoding));
+    }
+
+    return encodings.join(", ");
+}
+
+/**
+ * Asks for a compressed response in every encoding we can decode. The body
+ * of the reply then has to go through a decoder, see encodingOf().
+ */
+void ZContentDecoder::negotiate(QNetworkRequest &request)
+{
+    QByteArray accept = acceptEncoding();
+    if (!accept.isEmpty())
+        request.setRawHeader("Accept-Encoding", accept);
+}
+
+/**
+ * Returns the encoding of the body of \a reply. Replies to requests that
+ * weren't prepared with negotiate() have been decoded by Qt already.
+ */
+ZContentDecoder::Encoding ZContentDecoder::encodingOf(QNetworkReply *reply)
+{
+    if (!reply->request().hasRawHeader("Accept-Encoding"))
+        return Identity;
+
+    return fromName(reply->rawHeader("Content-Encoding"));
+}
+
+QByteArray ZContentDecoder::name(Encoding encoding)
+{
+    switch (encoding) {
+    case Identity:
+        return "identity";
+    case Gzip:
+        return "gzip";
+    case Deflate:
+        return "deflate";
+    case Brotli:
+        return "br";
+    case Zstd:
+        return "zstd";
+    case Xz:
+        return "xz";
+    default:
+        return "unsupported";
+    }
+}
+
+ZContentDecoder::Encoding ZContentDecoder::fromName(const QByteArray &name)
+{
+    QByteArray value = name.trimmed().toLower();
+    if (value.isEmpty() || value == "identity")
+        return Identity;
+    if (value == "gzip" || value == "x-gzip")
+        return Gzip;
+    if (value == "deflate")
+        return Deflate;
+    if (value == "br")
+        return Brotli;
+    if (value == "zstd")
+        return Zstd;
+    if (value == "xz")
+        return Xz;
+
+    return Unsupported;
+}
+
+/**
+ * Returns the compression of an asset named \a fileName, judging by its
+ * extension, and stores the name of the decompressed file in \a baseName
+ */
+ZContentDecoder::Encoding ZContentDecoder::fileEncoding(const QString &fileName,
+                                                        QString *baseName)
+{
+    static const QList<QPair<QString, Encoding>> extensions = {
+        {".zst", Zstd}, {".xz", Xz}};
+
+    for (const auto &extension : extensions) {
+        if (fileName.size() > extension.first.size() &&
+            fileName.endsWith(extension.first, Qt::CaseInsensitive)) {
+            if (baseName)
+                *baseName = fileName.chopped(extension.first.size());
+            return extension.second;
+        }
+    }
+
+    if (baseName)
+        *baseName = fileName;
+    return Identity;
+}
+
+/**
+ * Reads the whole body of the finished \a reply into \a data, decoded.
+ * Meant for small documents that are only looked at once complete.
+ */
+bool ZContentDecoder::readReply(QNetworkReply *reply, QByteArray *data,
+                                QString *error)
+{
+    ZContentDecoder decoder;
+    data->clear();
+
+    if (decoder.start(encodingOf(reply)) &&
+        decoder.decode(reply->readAll(), data))
+        decoder.finish(data);
+
+    if (decoder.hasError()) {
+        *error = decoder.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Prepares for a new body in \a encoding
+ */
+bool ZContentDecoder::start(Encoding encoding)
+{
+    reset();
+
+    m_encoding = encoding;
+    m_started = true;
+
+    switch (encoding) {
+    case Identity:
+        m_done = true;
+        return true;
+#ifdef ZUPDATER_HAVE_ZLIB
+    case Gzip:
+    case Deflate:
+        /* Detect the gzip or zlib header, servers mix them up for deflate */
+        m_zlib = new z_stream();
+        if (inflateInit2(m_zlib, 15 + 32) != Z_OK) {
+            delete m_zlib;
+            m_zlib = nullptr;
+            return setError(translate("Cannot initialize zlib"));
+        }
+        return true;
+#endif
+#ifdef ZUPDATER_HAVE_ZSTD
+    case Zstd:
+        m_zstd = ZSTD_createDCtx();
+        if (!m_zstd)
+            return setError(translate("Cannot initialize zstd"));
+        return true;
+#endif
+#ifdef ZUPDATER_HAVE_BROTLI
+    case Brotli:
+        m_brotli = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        if (!m_brotli)
+            return setError(translate("Cannot initialize brotli"));
+        return true;
+#endif
+#ifdef ZUPDATER_HAVE_LZMA
+    case Xz: {
+        m_lzma = new ZLzmaStream;
+#if LZMA_VERSION >= 50040002
+        /* Files made with "xz -T" have independent blocks that can be
+         * decoded in parallel */
+        lzma_mt options = {};
+        options.threads = quint32(qMax(1, QThread::idealThreadCount()));
+        options.memlimit_threading = LZMA_THREADING_MEMLIMIT;
+        options.memlimit_stop = UINT64_MAX;
+        options.flags = LZMA_CONCATENATED;
+        lzma_ret ret = lzma_stream_decoder_mt(&m_lzma->stream, &options);
+#else
+        lzma_ret ret = lzma_stream_decoder(&m_lzma->stream, UINT64_MAX,
+                                           LZMA_CONCATENATED);
+#endif
+        if (ret != LZMA_OK)
+            return setError(translate("Cannot initialize xz"));
+        return true;
+    }
+#endif
+    default:
+        return setError(translate("Unsupported content encoding: %1")
+                            .arg(QString::fromLatin1(name(encoding))));
+    }
+}
+
+/**
+ * Releases the decoder state, start() has to be called again before the
+ * next body
+ */
+void ZContentDecoder::reset()
+{
+#ifdef ZUPDATER_HAVE_ZLIB
+    if (m_zlib) {
+        inflateEnd(m_zlib);
+        delete m_zlib;
+        m_zlib = nullptr;
+    }
+#endif
+#ifdef ZUPDATER_HAVE_ZSTD
+    ZSTD_freeDCtx(m_zstd);
+    m_zstd = nullptr;
+#endif
+#ifdef ZUPDATER_HAVE_BROTLI
+    if (m_brotli) {
+        BrotliDecoderDestroyInstance(m_brotli);
+        m_brotli = nullptr;
+    }
+#endif
+#ifdef ZUPDATER_HAVE_LZMA
+    if (m_lzma) {
+        lzma_end(&m_lzma->stream);
+        delete m_lzma;
+        m_lzma = nullptr;
+    }
+#endif
+
+    m_encoding = Identity;
+    m_started = false;
+    m_done = false;
+    m_error.clear();
+    m_bytesIn = 0;
+    m_bytesOut = 0;
+}
+
+/**
+ * Decodes the next chunk of the body and appends the result to \a output.
+ * zstd and xz data may consist of several frames (or streams) one after the
+ * other, as written by parallel compressors, they are all decoded. Data after
+ * the end of a gzip, deflate or brotli stream is ignored.
+ */
+bool ZContentDecoder::decode(const QByteArray &data, QByteArray *output)
+{
+    if (!m_started)
+        return setError(translate("Decoder not started"));
+    if (hasError())
+        return false;
+
+    m_bytesIn += data.size();
+    qint64 before = output->size();
+
+    bool ok = true;
+    if (m_encoding == Identity)
+        output->append(data);
+    else if (m_done && !m_zstd)
+        return true;
+    else if (m_zlib)
+        ok = decodeZlib(data, output);
+    else if (m_zstd)
+        ok = decodeZstd(data, output);
+    else if (m_brotli)
+        ok = decodeBrotli(data, output);
+    else if (m_lzma)
+        ok = decodeXz(data, output, false);
+
+    m_bytesOut += output->size() - before;
+    return ok;
+}
+
+/**
+ * Called once all the data has been passed to decode(): appends what the
+ * decoder still holds to \a output, and fails if the compressed stream was
+ * cut short
+ */
+bool ZContentDecoder::finish(QByteArray *output)
+{
+    if (!m_started)
+        return setError(translate("Decoder not started"));
+    if (hasError())
+        return false;
+    if (m_done)
+        return true;
+
+    qint64 before = output->size();
+    if (m_lzma)
+        decodeXz(QByteArray(), output, true);
+    m_bytesOut += output->size() - before;
+
+    if (!m_done && !hasError())
+        setError(translate("Truncated compressed data"));
+
+    return m_done && !hasError();
+}
+
+bool ZContentDecoder::decodeZlib(const QByteArray &data, QByteArray *output)
+{
+#ifdef ZUPDATER_HAVE_ZLIB
+    m_zlib->next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    m_zlib->avail_in = uInt(data.size());
+
+    forever {
+        qint64 used = output->size();
+        output->resize(used + OUTPUT_CHUNK);
+        m_zlib->next_out = reinterpret_cast<Bytef *>(output->data() + used);
+        m_zlib->avail_out = uInt(OUTPUT_CHUNK);
+
+        int ret = inflate(m_zlib, Z_NO_FLUSH);
+        output->resize(output->size() - m_zlib->avail_out);
+
+        if (ret == Z_STREAM_END) {
+            m_done = true;
+            return true;
+        }
+
+        /* Z_BUF_ERROR only means that more input is needed */
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+            return setError(m_zlib->msg ? QString::fromLatin1(m_zlib->msg)
+                                        : translate("Invalid compressed data"));
+
+        if (ret == Z_BUF_ERROR ||
+            (m_zlib->avail_in == 0 && m_zlib->avail_out > 0))
+            return true;
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(output);
+    return false;
+#endif
+}
+
+bool ZContentDecoder::decodeZstd(const QByteArray &data, QByteArray *output)
+{
+#ifdef ZUPDATER_HAVE_ZSTD
+    ZSTD_inBuffer in = {data.constData(), size_t(data.size()), 0};
+
+    /* More input after the end of a frame starts the next one */
+    if (in.size > 0)
+        m_done = false;
+
+    forever {
+        qint64 used = output->size();
+        output->resize(used + OUTPUT_CHUNK);
+        ZSTD_outBuffer out = {output->data() + used, size_t(OUTPUT_CHUNK), 0};
+
+        size_t ret = ZSTD_decompressStream(m_zstd, &out, &in);
+        output->resize(used + qint64(out.pos));
+        if (ZSTD_isError(ret))
+            return setError(QString::fromLatin1(ZSTD_getErrorName(ret)));
+
+        /* The end of a frame, another one may follow. Anything that is not
+         * a valid frame fails in the next round. */
+        if (ret == 0) {
+            if (in.pos == in.size) {
+                m_done = true;
+                return true;
+            }
+
+            ZSTD_DCtx_reset(m_zstd, ZSTD_reset_session_only);
+            continue;
+        }
+
+        /* Input used up and the decoder has nothing buffered */
+        if (in.pos == in.size && out.pos < out.size)
+            return true;
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(output);
+    return false;
+#endif
+}
+
+bool ZContentDecoder::decodeBrotli(const QByteArray &data, QByteArray *output)
+{
+#ifdef ZUPDATER_HAVE_BROTLI
+    size_t availableIn = size_t(data.size());
+    const uint8_t *nextIn =
+        reinterpret_cast<const uint8_t *>(data.constData());
+
+    forever {
+        qint64 used = output->size();
+        output->resize(used + OUTPUT_CHUNK);
+        size_t availableOut = size_t(OUTPUT_CHUNK);
+        uint8_t *nextOut = reinterpret_cast<uint8_t *>(output->data() + used);
+
+        BrotliDecoderResult ret = BrotliDecoderDecompressStream(
+            m_brotli, &availableIn, &nextIn, &availableOut, &nextOut, nullptr);
+        output->resize(output->size() - qint64(availableOut));
+
+        switch (ret) {
+        case BROTLI_DECODER_RESULT_SUCCESS:
+            m_done = true;
+            return true;
+        case BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT:
+            return true;
+        case BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT:
+            break;
+        default:
+            return setError(QString::fromLatin1(BrotliDecoderErrorString(
+                BrotliDecoderGetErrorCode(m_brotli))));
+        }
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(output);
+    return false;
+#endif
+}
+
+/**
+ * Runs \a data through xz. The threaded decoder may hold back output until
+ * it is told that no more input follows, which is what \a last does.
+ */
+bool ZContentDecoder::decodeXz(const QByteArray &data, QByteArray *output,
+                               bool last)
+{
+#ifdef ZUPDATER_HAVE_LZMA
+    lzma_stream *stream = &m_lzma->stream;
+    stream->next_in = reinterpret_cast<const uint8_t *>(data.constData());
+    stream->avail_in = size_t(data.size());
+
+    forever {
+        qint64 used = output->size();
+        output->resize(used + OUTPUT_CHUNK);
+        stream->next_out = reinterpret_cast<uint8_t *>(output->data() + used);
+        stream->avail_out = size_t(OUTPUT_CHUNK);
+
+        lzma_ret ret = lzma_code(stream, last ? LZMA_FINISH : LZMA_RUN);
+        output->resize(output->size() - qint64(stream->avail_out));
+
+        switch (ret) {
+        case LZMA_STREAM_END:
+            m_done = true;
+            return true;
+        case LZMA_OK:
+            break;
+        case LZMA_BUF_ERROR:
+            return last ? setError(translate("Truncated compressed data"))
+                        : true;
+        case LZMA_MEM_ERROR:
+        case LZMA_MEMLIMIT_ERROR:
+            return setError(translate("Not enough memory to decompress"));
+        case LZMA_FORMAT_ERROR:
+            return setError(translate("Not an xz file"));
+        default:
+            return setError(translate("Invalid compressed data"));
+        }
+
+        /* Input used up and the decoder has nothing buffered */
+        if (!last && stream->avail_in == 0 && stream->avail_out > 0)
+            return true;
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(output);
+    Q_UNUSED(last);
+    return false;
+#endif
+}
+
+bool ZContentDecoder::setError(const QString &error)
+{
+    m_error = error;
+    return false;
+}
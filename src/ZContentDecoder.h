@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZCONTENT_DECODER_H
+#define ZCONTENT_DECODER_H
+
+#include <QByteArray>
+#include <QString>
+
+class QNetworkReply;
+class QNetworkRequest;
+struct z_stream_s;
+struct ZSTD_DCtx_s;
+struct BrotliDecoderStateStruct;
+struct ZLzmaStream;
+
+/**
+ * Streaming decoder for compressed HTTP bodies and assets.
+ *
+ * Qt only decompresses the encodings it asks for itself, and hides the size
+ * of the body on the wire. Requests prepared with negotiate() instead offer
+ * every encoding this build can decode (zstd, brotli, gzip and deflate, as
+ * far as the libraries were found at build time) and the reply is decoded
+ * here, chunk by chunk as it arrives, so that the caller can keep parsing
+ * while the rest is still in flight. bytesIn() and bytesOut() count the
+ * encoded and decoded sizes.
+ *
+ * A build without any of the libraries leaves the negotiation to Qt.
+ *
+ * The same decoder unpacks release assets published pre-compressed
+ * ("<asset>.zst" or "<asset>.xz", see fileEncoding()) while they download.
+ */
+class ZContentDecoder
+{
+public:
+    enum Encoding { Identity, Gzip, Deflate, Brotli, Zstd, Xz, Unsupported };
+
+    ZContentDecoder();
+    ~ZContentDecoder();
+
+    static bool isSupported(Encoding encoding);
+    static QByteArray acceptEncoding();
+    static void negotiate(QNetworkRequest &request);
+    static Encoding encodingOf(QNetworkReply *reply);
+    static QByteArray name(Encoding encoding);
+    static Encoding fromName(const QByteArray &name);
+    static Encoding fileEncoding(const QString &fileName,
+                                 QString *baseName = nullptr);
+    static bool readReply(QNetworkReply *reply, QByteArray *data,
+                          QString *error);
+
+    bool start(Encoding encoding);
+    void reset();
+    bool decode(const QByteArray &data, QByteArray *output);
+    bool finish(QByteArray *output);
+
+    bool isStarted() const { return m_started; }
+    Encoding encoding() const { return m_encoding; }
+    bool atEnd() const { return m_done; }
+    bool hasError() const { return !m_error.isEmpty(); }
+    QString errorString() const { return m_error; }
+
+    qint64 bytesIn() const { return m_bytesIn; }
+    qint64 bytesOut() const { return m_bytesOut; }
+
+private:
+    bool decodeZlib(const QByteArray &data, QByteArray *output);
+    bool decodeZstd(const QByteArray &data, QByteArray *output);
+    bool decodeBrotli(const QByteArray &data, QByteArray *output);
+    bool decodeXz(const QByteArray &data, QByteArray *output, bool last);
+    bool setError(const QString &error);
+
+    Encoding m_encoding;
+    bool m_started;
+    bool m_done;
+    QString m_error;
+
+    z_stream_s *m_zlib;
+    ZSTD_DCtx_s *m_zstd;
+    BrotliDecoderStateStruct *m_brotli;
+    ZLzmaStream *m_lzma;
+
+    qint64 m_bytesIn;
+    qint64 m_bytesOut;
+};
+
+#endif
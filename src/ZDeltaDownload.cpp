@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZDeltaDownload.h"
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+#ifdef ZUPDATER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* Bounds the memory held by the reply, the patch is decoded as it arrives */
+static const qint64 PATCH_READ_BUFFER = 1024 * 1024;
+
+ZDeltaDownload::ZDeltaDownload(QNetworkAccessManager *manager, QObject *parent)
+    : QObject(parent), m_manager(manager), m_reply(nullptr), m_dctx(nullptr),
+      m_running(false), m_frameDone(false)
+{
+}
+
+ZDeltaDownload::~ZDeltaDownload() { abort(); }
+
+/**
+ * Returns true if the library was built with zstd and can apply patches
+ */
+bool ZDeltaDownload::isSupported()
+{
+#ifdef ZUPDATER_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Downloads the patch described by \a request and applies it to
+ * \a basePath, writing the result to \a filePath
+ */
+void ZDeltaDownload::start(const QNetworkRequest &request,
+                           const QString &basePath, const QString &filePath)
+{
+    abort();
+
+    m_running = true;
+    m_frameDone = false;
+    m_sha256.clear();
+
+#ifdef ZUPDATER_HAVE_ZSTD
+    /* The old file is the dictionary, it has to stay mapped until the
+     * whole frame is decoded */
+    m_base.setFileName(basePath);
+    const uchar *base = nullptr;
+    if (m_base.open(QIODevice::ReadOnly))
+        base = m_base.map(0, m_base.size());
+    if (!base) {
+        fail(m_base.errorString());
+        return;
+    }
+
+    m_dctx = ZSTD_createDCtx();
+    ZSTD_DCtx_setParameter(m_dctx, ZSTD_d_windowLogMax, ZSTD_WINDOWLOG_MAX);
+    size_t ret = ZSTD_DCtx_refPrefix(m_dctx, base, size_t(m_base.size()));
+    if (ZSTD_isError(ret)) {
+        fail(ZSTD_getErrorName(ret));
+        return;
+    }
+
+    m_output.resize(qint64(ZSTD_DStreamOutSize()));
+#else
+    Q_UNUSED(basePath);
+    fail(tr("Delta updates are not supported by this build"));
+    return;
+#endif
+
+    m_sink.setHashing(true);
+    if (!m_sink.open(filePath)) {
+        fail(m_sink.errorString());
+        return;
+    }
+
+    m_reply = m_manager->get(request);
+    m_reply->setReadBufferSize(PATCH_READ_BUFFER);
+    connect(m_reply, &QNetworkReply::readyRead, this,
+            &ZDeltaDownload::readPatch);
+    connect(m_reply, &QNetworkReply::downloadProgress, this,
+            &ZDeltaDownload::downloadProgress);
+    connect(m_reply, &QNetworkReply::finished, this,
+            &ZDeltaDownload::patchFinished);
+}
+
+/**
+ * Cancels the download, the (partial) output is left on disk
+ */
+void ZDeltaDownload::abort()
+{
+    if (!m_running)
+        return;
+
+    m_running = false;
+    clear();
+}
+
+void ZDeltaDownload::readPatch()
+{
+    int status =
+        m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 200)
+        return;
+
+    QByteArray data = m_reply->readAll();
+    decode(data.constData(), data.size());
+}
+
+void ZDeltaDownload::patchFinished()
+{
+    QNetworkReply *reply = m_reply;
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+
+    QByteArray data = reply->readAll();
+    if (!decode(data.constData(), data.size()))
+        return;
+
+    if (!m_frameDone) {
+        fail(tr("The patch is truncated"));
+        return;
+    }
+
+    m_sink.close();
+    m_sha256 = m_sink.hash();
+
+    qint64 patchSize =
+        reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    qDebug() << "ZDeltaDownload: applied a" << patchSize << "byte patch,"
+             << m_sink.bytesWritten() << "bytes written";
+
+    m_running = false;
+    clear();
+    emit finished();
+}
+
+/**
+ * Runs \a size bytes of the patch through the decoder and writes whatever
+ * comes out to the target file
+ */
+bool ZDeltaDownload::decode(const char *data, qint64 size)
+{
+#ifdef ZUPDATER_HAVE_ZSTD
+    if (m_frameDone) {
+        if (size > 0)
+            fail(tr("Unexpected data after the patch"));
+        return size == 0;
+    }
+
+    ZSTD_inBuffer in = {data, size_t(size), 0};
+    forever {
+        ZSTD_outBuffer out = {m_output.data(), size_t(m_output.size()), 0};
+        size_t ret = ZSTD_decompressStream(m_dctx, &out, &in);
+        if (ZSTD_isError(ret)) {
+            fail(ZSTD_getErrorName(ret));
+            return false;
+        }
+
+        if (out.pos > 0 &&
+            !m_sink.write(m_output.constData(), qint64(out.pos))) {
+            fail(m_sink.errorString());
+            return false;
+        }
+
+        /* The end of the frame, nothing may follow */
+        if (ret == 0) {
+            m_frameDone = true;
+            if (in.pos < in.size) {
+                fail(tr("Unexpected data after the patch"));
+                return false;
+            }
+            return true;
+        }
+
+        /* Input used up and the decoder has nothing buffered */
+        if (in.pos == in.size && out.pos < out.size)
+            return true;
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
+
+void ZDeltaDownload::fail(const QString &error)
+{
+    if (!m_running)
+        return;
+
+    qWarning() << "ZDeltaDownload:" << error;
+    m_running = false;
+    clear();
+    emit failed(error);
+}
+
+void ZDeltaDownload::clear()
+{
+    if (m_reply) {
+        m_reply->disconnect(this);
+        if (!m_reply->isFinished())
+            m_reply->abort();
+        m_reply->deleteLater();
+        m_reply = nullptr;
+    }
+
+#ifdef ZUPDATER_HAVE_ZSTD
+    ZSTD_freeDCtx(m_dctx);
+    m_dctx = nullptr;
+#endif
+
+    m_sink.close();
+    m_base.close();
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZDELTA_DOWNLOAD_H
+#define ZDELTA_DOWNLOAD_H
+
+#include "ZFileSink.h"
+#include <QByteArray>
+#include <QFile>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QString>
+
+class QNetworkReply;
+class QNetworkAccessManager;
+struct ZSTD_DCtx_s;
+
+/**
+ * Downloads a binary delta and applies it on the fly.
+ *
+ * The patch is a zstd frame created with "zstd --patch-from=<old> <new>",
+ * which compresses the new file using the old one as a dictionary. It is
+ * decompressed as it arrives, with the installed file mapped as the
+ * dictionary, and the output is streamed (and hashed) into the target file.
+ *
+ * Delta support needs zstd at build time, see isSupported(). Any failure is
+ * reported through failed(), the caller is expected to fall back to the full
+ * download.
+ */
+class ZDeltaDownload : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void downloadProgress(qint64 received, qint64 total);
+    void finished();
+    void failed(const QString &error);
+
+public:
+    explicit ZDeltaDownload(QNetworkAccessManager *manager,
+                            QObject *parent = nullptr);
+    ~ZDeltaDownload();
+
+    static bool isSupported();
+
+    bool isRunning() const { return m_running; }
+    QByteArray sha256() const { return m_sha256; }
+
+public slots:
+    void start(const QNetworkRequest &request, const QString &basePath,
+               const QString &filePath);
+    void abort();
+
+private slots:
+    void readPatch();
+    void patchFinished();
+
+private:
+    bool decode(const char *data, qint64 size);
+    void fail(const QString &error);
+    void clear();
+
+    QNetworkAccessManager *m_manager;
+    QNetworkReply *m_reply;
+
+    QFile m_base;
+    ZFileSink m_sink;
+    QByteArray m_output;
+    ZSTD_DCtx_s *m_dctx;
+
+    bool m_running;
+    bool m_frameDone;
+    QByteArray m_sha256;
+};
+
+#endif
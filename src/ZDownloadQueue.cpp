@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZDownloadQueue.h"
+#include "ZNetworkContext.h"
+#include "ZTransfer.h"
+#include <QDebug>
+#include <QThread>
+#include <limits>
+
+ZDownloadQueue::ZDownloadQueue(ZNetworkContext *network, QObject *parent)
+    : QObject(parent),
+      m_network(network ? network : ZNetworkContext::instance()),
+      m_maxConnections(DefaultMaxConnections), m_rateLimit(0), m_nextId(0),
+      m_running(false)
+{
+}
+
+ZDownloadQueue::~ZDownloadQueue() { abort(); }
+
+void ZDownloadQueue::setMaxConnections(int count)
+{
+    m_maxConnections = qMax(1, count);
+    if (m_running)
+        schedule();
+}
+
+void ZDownloadQueue::setRateLimit(qint64 bytesPerSecond)
+{
+    m_rateLimit = qMax<qint64>(bytesPerSecond, 0);
+    applyRateLimit();
+}
+
+void ZDownloadQueue::setWriteStrategy(const ZWriteStrategy &strategy)
+{
+    m_writeStrategy = strategy;
+}
+
+/**
+ * Queues the asset of \a downloadProfile for download into \a downloadDir
+ * and returns its id. The size of the asset, if the profile has one, decides
+ * the order among downloads of the same \a priority.
+ */
+int ZDownloadQueue::add(const QVariantMap &downloadProfile,
+                        const QString &downloadDir, int priority)
+{
+    Download download;
+    download.id = m_nextId++;
+    download.profile = downloadProfile;
+    download.dir = downloadDir;
+    download.priority = priority;
+    download.size = downloadProfile
+                        .value("download_size", downloadProfile.value("size"))
+                        .toLongLong();
+    download.received = 0;
+    download.total = download.size;
+    download.state = Queued;
+    m_downloads.append(download);
+
+    if (m_running)
+        schedule();
+
+    return download.id;
+}
+
+/**
+ * Starts downloading, finished() is emitted once every download has either
+ * finished or failed
+ */
+void ZDownloadQueue::start()
+{
+    if (m_running)
+        return;
+
+    m_running = true;
+    m_clock.start();
+    schedule();
+}
+
+/**
+ * Cancels the running downloads and forgets about the queued ones
+ */
+void ZDownloadQueue::abort()
+{
+    m_running = false;
+
+    for (Download &download : m_downloads) {
+        if (download.state != Running && download.state != Queued)
+            continue;
+
+        /* Don't wait for the transfer thread, it may be busy or stopping.
+         * The abort runs there before the transfer is deleted. */
+        if (download.transfer) {
+            if (download.transfer->thread()->isRunning())
+                QMetaObject::invokeMethod(download.transfer, "abort",
+                                          Qt::QueuedConnection);
+            releaseTransfer(&download);
+        }
+
+        download.state = Failed;
+        download.error = tr("Download cancelled");
+    }
+}
+
+QList<int> ZDownloadQueue::ids() const
+{
+    QList<int> list;
+    for (const Download &download : m_downloads)
+        list.append(download.id);
+
+    return list;
+}
+
+QVariantMap ZDownloadQueue::downloadProfile(int id) const
+{
+    const Download *download = find(id);
+    return download ? download->profile : QVariantMap();
+}
+
+QString ZDownloadQueue::filePath(int id) const
+{
+    const Download *download = find(id);
+    return download ? download->filePath : QString();
+}
+
+QString ZDownloadQueue::errorString(int id) const
+{
+    const Download *download = find(id);
+    return download ? download->error : QString();
+}
+
+int ZDownloadQueue::failedCount() const
+{
+    int count = 0;
+    for (const Download &download : m_downloads) {
+        if (download.state == Failed)
+            ++count;
+    }
+
+    return count;
+}
+
+ZDownloadQueue::Download *ZDownloadQueue::find(int id)
+{
+    for (Download &download : m_downloads) {
+        if (download.id == id)
+            return &download;
+    }
+
+    return nullptr;
+}
+
+const ZDownloadQueue::Download *ZDownloadQueue::find(int id) const
+{
+    return const_cast<ZDownloadQueue *>(this)->find(id);
+}
+
+/**
+ * Returns the queued download that should start next: the highest
+ * priority first, then the smallest (downloads of unknown size go last)
+ */
+ZDownloadQueue::Download *ZDownloadQueue::next()
+{
+    Download *best = nullptr;
+    for (Download &download : m_downloads) {
+        if (download.state != Queued)
+            continue;
+
+        qint64 size = download.size > 0 ? download.size
+                                         : std::numeric_limits<qint64>::max();
+        qint64 bestSize = !best || best->size <= 0
+                              ? std::numeric_limits<qint64>::max()
+                              : best->size;
+
+        if (!best || download.priority > best->priority ||
+            (download.priority == best->priority && size < bestSize))
+            best = &download;
+    }
+
+    return best;
+}
+
+/**
+ * Starts queued downloads while there are connections left, and reports
+ * when there is nothing left to do
+ */
+void ZDownloadQueue::schedule()
+{
+    if (!m_running)
+        return;
+
+    int running = 0;
+    for (const Download &download : std::as_const(m_downloads)) {
+        if (download.state == Running)
+            ++running;
+    }
+
+    /* The new downloads count for the share of the rate limit, which they
+     * get before they start */
+    QList<Download *> starting;
+    while (running < m_maxConnections) {
+        Download *download = next();
+        if (!download)
+            break;
+
+        download->state = Running;
+        starting.append(download);
+        ++running;
+    }
+
+    applyRateLimit();
+    for (Download *download : std::as_const(starting))
+        startDownload(download);
+
+    if (running > 0)
+        return;
+
+    qDebug() << "ZDownloadQueue:" << m_downloads.size() << "downloads in"
+             << m_clock.elapsed() << "ms," << failedCount() << "failed";
+
+    m_running = false;
+    emit finished();
+}
+
+void ZDownloadQueue::startDownload(Download *download)
+{
+    download->state = Running;
+    int id = download->id;
+    qint64 rateLimit = rateShare();
+
+    ZTransfer *transfer = new ZTransfer(m_network->transferManager());
+    transfer->moveToThread(m_network->transferThread());
+    connect(m_network->transferThread(), &QThread::finished, transfer,
+            &QObject::deleteLater);
+
+    /* Signals the transfer sent before it was released may still arrive,
+     * they no longer belong to the download */
+    auto current = [this, id, transfer]() -> Download * {
+        Download *download = find(id);
+        return download && download->transfer == transfer ? download
+                                                          : nullptr;
+    };
+    connect(transfer, &ZTransfer::progress, this,
+            [this, current](qint64 received, qint64 total) {
+                if (Download *download = current())
+                    updateProgress(download, received, total);
+            });
+    connect(transfer, &ZTransfer::finished, this,
+            [this, current](const QUrl &, const QString &filePath) {
+                if (Download *download = current())
+                    finishDownload(download, filePath, QString());
+            });
+    connect(transfer, &ZTransfer::failed, this,
+            [this, current](const QString &error) {
+                if (Download *download = current())
+                    finishDownload(download, QString(), error);
+            });
+    download->transfer = transfer;
+
+    const QVariantMap &profile = download->profile;
+    QString dir = download->dir;
+    QString fileName = profile.value("file_name").toString();
+    ZWriteStrategy writeStrategy = m_writeStrategy;
+    QByteArray sha256 = profile.value("sha256").toString().toUtf8();
+    QUrl checksumsUrl(profile.value("checksums_url").toString());
+    ZContentDecoder::Encoding compression = ZContentDecoder::fromName(
+        profile.value("encoding").toString().toLatin1());
+    QUrl url(profile.value("browser_download_url").toString());
+
+    QMetaObject::invokeMethod(transfer, [=]() {
+        transfer->setDownloadDir(dir);
+        transfer->setFileName(fileName);
+        transfer->setSegmentCount(1);
+        transfer->setWriteStrategy(writeStrategy);
+        transfer->setExpectedHash(sha256);
+        transfer->setChecksumsUrl(checksumsUrl);
+        transfer->setCompression(compression);
+        transfer->setRateLimit(rateLimit, false);
+        transfer->start(url);
+    });
+}
+
+void ZDownloadQueue::finishDownload(Download *download,
+                                    const QString &filePath,
+                                    const QString &error)
+{
+    releaseTransfer(download);
+    download->filePath = filePath;
+    download->error = error;
+    download->state = error.isEmpty() ? Finished : Failed;
+
+    /* Count a finished download as complete even if its size was off */
+    if (download->state == Finished)
+        download->received = download->total;
+
+    int id = download->id;
+    if (error.isEmpty())
+        emit downloadFinished(id, filePath);
+    else
+        emit downloadFailed(id, error);
+
+    schedule();
+}
+
+void ZDownloadQueue::updateProgress(Download *download, qint64 received,
+                                    qint64 total)
+{
+    download->received = received;
+    if (total > 0)
+        download->total = total;
+
+    qint64 sumReceived = 0;
+    qint64 sumTotal = 0;
+    for (const Download &d : std::as_const(m_downloads)) {
+        if (d.state == Failed)
+            continue;
+
+        sumReceived += d.received;
+        sumTotal += qMax(d.total, d.received);
+    }
+
+    emit progress(sumReceived, sumTotal);
+}
+
+/**
+ * Returns the rate limit of each running download, the limit split evenly
+ * between them
+ */
+qint64 ZDownloadQueue::rateShare() const
+{
+    int running = 0;
+    for (const Download &download : m_downloads) {
+        if (download.state == Running)
+            ++running;
+    }
+
+    if (m_rateLimit <= 0 || running == 0)
+        return 0;
+
+    return qMax<qint64>(m_rateLimit / running, 1);
+}
+
+/**
+ * Passes the current share of the rate limit to the running transfers
+ */
+void ZDownloadQueue::applyRateLimit()
+{
+    qint64 share = rateShare();
+    for (const Download &download : std::as_const(m_downloads)) {
+        if (download.state != Running || !download.transfer)
+            continue;
+
+        ZTransfer *transfer = download.transfer;
+        QMetaObject::invokeMethod(transfer, [transfer, share]() {
+            transfer->setRateLimit(share, false);
+        });
+    }
+}
+
+void ZDownloadQueue::releaseTransfer(Download *download)
+{
+    if (!download->transfer)
+        return;
+
+    download->transfer->disconnect(this);
+    download->transfer->deleteLater();
+    download->transfer = nullptr;
+}
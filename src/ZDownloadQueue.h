@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZDOWNLOAD_QUEUE_H
+#define ZDOWNLOAD_QUEUE_H
+
+#include "ZFileSink.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QVariantMap>
+
+class ZTransfer;
+class ZNetworkContext;
+
+/**
+ * Downloads several assets with a shared connection and bandwidth budget.
+ *
+ * Each download is described by a download profile (see ZUpdateClient) and
+ * a priority. Higher priorities start first, and among downloads of the
+ * same priority the smaller ones do, so that small critical assets are not
+ * stuck behind a large one. At most maxConnections() downloads run at the
+ * same time, one connection each, and the rate limit (if any) is split
+ * evenly between the running ones.
+ *
+ * The transfers run in the shared transfer thread. progress() reports the
+ * sum over all downloads, which makes it usable for a single progress bar
+ * and time estimate (see ZDownloader::startDownloads()).
+ */
+class ZDownloadQueue : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void progress(qint64 received, qint64 total);
+    void downloadFinished(int id, const QString &filePath);
+    void downloadFailed(int id, const QString &error);
+    void finished();
+
+public:
+    static constexpr int DefaultMaxConnections = 4;
+
+    explicit ZDownloadQueue(ZNetworkContext *network = nullptr,
+                            QObject *parent = nullptr);
+    ~ZDownloadQueue();
+
+    int maxConnections() const { return m_maxConnections; }
+    void setMaxConnections(int count);
+
+    // Total bandwidth of all downloads in bytes per second, 0 for no limit
+    qint64 rateLimit() const { return m_rateLimit; }
+    void setRateLimit(qint64 bytesPerSecond);
+
+    ZWriteStrategy writeStrategy() const { return m_writeStrategy; }
+    void setWriteStrategy(const ZWriteStrategy &strategy);
+
+    int add(const QVariantMap &downloadProfile, const QString &downloadDir,
+            int priority = 0);
+    void start();
+    void abort();
+
+    bool isRunning() const { return m_running; }
+    QList<int> ids() const;
+    QVariantMap downloadProfile(int id) const;
+    QString filePath(int id) const;
+    QString errorString(int id) const;
+    int failedCount() const;
+
+private:
+    enum State { Queued, Running, Finished, Failed };
+
+    struct Download {
+        int id;
+        QVariantMap profile;
+        QString dir;
+        int priority;
+        qint64 size;
+        qint64 received;
+        qint64 total;
+        State state;
+        QPointer<ZTransfer> transfer;
+        QString filePath;
+        QString error;
+    };
+
+    Download *find(int id);
+    const Download *find(int id) const;
+    Download *next();
+    void schedule();
+    void startDownload(Download *download);
+    void finishDownload(Download *download, const QString &filePath,
+                        const QString &error);
+    void updateProgress(Download *download, qint64 received, qint64 total);
+    qint64 rateShare() const;
+    void applyRateLimit();
+    void releaseTransfer(Download *download);
+
+    ZNetworkContext *m_network;
+    int m_maxConnections;
+    qint64 m_rateLimit;
+    ZWriteStrategy m_writeStrategy;
+
+    QList<Download> m_downloads;
+    int m_nextId;
+    bool m_running;
+    QElapsedTimer m_clock;
+};
+
+#endif
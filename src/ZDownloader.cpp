@@ -22,23 +22,33 @@
  */
 
 #include "ZDownloader.h"
-#include <QDateTime>
+#include "ZDownloadQueue.h"
+#include "ZNetworkContext.h"
+#include "ZTransfer.h"
+#include <QDebug>
 #include <QDesktopServices>
 #include <QDir>
+#include <QEvent>
 #include <QFile>
+#include <QFileInfo>
 #include <QMessageBox>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
 #include <QProcess>
-#include <QRegularExpression>
-#include <QRegularExpressionMatch>
+#include <QLocale>
 #include <QStandardPaths>
 #include <QTimer>
 #include <math.h>
 
-static const QString PARTIAL_DOWN(".part");
+/* Time constant of the speed average, longer is steadier but slower to
+ * follow real changes */
+static const qreal SPEED_TAU_MS = 3000;
 
 ZDownloader::ZDownloader(UpdateProcedure updateProcedure, QWidget *parent)
+    : ZDownloader(updateProcedure, ZNetworkContext::instance(), parent)
+{
+}
+
+ZDownloader::ZDownloader(UpdateProcedure updateProcedure,
+                         ZNetworkContext *network, QWidget *parent)
     : QWidget(parent), m_ui(new Ui::ZDownloader),
       m_updateProcedure(updateProcedure)
 {
@@ -46,10 +56,22 @@ ZDownloader::ZDownloader(UpdateProcedure updateProcedure, QWidget *parent)
     setAttribute(Qt::WA_DeleteOnClose);
 
     /* Initialize private members */
-    m_manager = new QNetworkAccessManager(this);
-
+    m_running = false;
+    m_readBufferSize = DefaultReadBufferSize;
+    m_segmentCount = 1;
+    m_rateLimit = 0;
+    m_backgroundMode = false;
+    m_metricsEnabled = false;
+    m_compression = ZContentDecoder::Identity;
     m_fileName = "";
-    m_startTime = 0;
+    m_progressDirty = false;
+    m_received = 0;
+    m_total = 0;
+    m_renderedTotal = -1;
+    m_repaints = 0;
+    m_sampleTime = -1;
+    m_sampleBytes = 0;
+    m_speed = 0;
 
     /* Set download directory */
     QString dl =
@@ -58,6 +80,22 @@ ZDownloader::ZDownloader(UpdateProcedure updateProcedure, QWidget *parent)
         dl = QDir::homePath();
     m_downloadDir.setPath(dl);
 
+    /* Network and disk I/O happen in the shared transfer thread, we only get
+     * (throttled) progress notifications through queued connections. The
+     * connections and TLS sessions of the shared manager outlive us. */
+    m_transfer = new ZTransfer(network->transferManager());
+    m_transfer->moveToThread(network->transferThread());
+    connect(network->transferThread(), SIGNAL(finished()), m_transfer,
+            SLOT(deleteLater()));
+    connect(m_transfer, SIGNAL(progress(qint64, qint64)), this,
+            SLOT(updateProgress(qint64, qint64)));
+    connect(m_transfer, SIGNAL(retrying(int)), this, SLOT(retrying(int)));
+    connect(m_transfer, SIGNAL(finished(QUrl, QString)), this,
+            SLOT(finished(QUrl, QString)));
+    connect(m_transfer, SIGNAL(failed(QString)), this, SLOT(failed(QString)));
+    connect(m_transfer, SIGNAL(metrics(ZMetrics)), this,
+            SLOT(publishMetrics(ZMetrics)));
+
     /* Make the window look like a modal dialog */
     setWindowFlags(Qt::Dialog | Qt::CustomizeWindowHint | Qt::WindowTitleHint);
 
@@ -67,60 +105,114 @@ ZDownloader::ZDownloader(UpdateProcedure updateProcedure, QWidget *parent)
     connect(m_ui->stopButton, SIGNAL(clicked()), this, SLOT(cancelDownload()));
     connect(m_ui->openButton, SIGNAL(clicked()), this, SLOT(installUpdate()));
 
+    /* Progress notifications only record the numbers, the widgets are
+     * redrawn from this timer */
+    m_renderTimer.setInterval(RenderInterval);
+    connect(&m_renderTimer, SIGNAL(timeout()), this, SLOT(renderProgress()));
+
     /* Resize to fit */
     setFixedSize(minimumSizeHint());
 }
 
-ZDownloader::~ZDownloader() { delete m_ui; }
+ZDownloader::~ZDownloader()
+{
+    /* Stop the transfer in its own thread without waiting for it, the
+     * thread may be busy writing or already stopping. The transfer runs the
+     * abort before it is deleted there. It is already gone if the shared
+     * transfer thread was stopped before us. */
+    if (m_transfer) {
+        m_transfer->disconnect(this);
+        if (m_transfer->thread()->isRunning())
+            QMetaObject::invokeMethod(m_transfer, "abort",
+                                      Qt::QueuedConnection);
+        m_transfer->deleteLater();
+    }
+
+    delete m_ui;
+}
 
 /**
  * Begins downloading the file at the given \a url
  */
 void ZDownloader::startDownload(const QUrl &url)
 {
-    /* Reset UI */
-    m_ui->progressBar->setValue(0);
-    m_ui->stopButton->setText(tr("Stop"));
-    m_ui->downloadLabel->setText(tr("Downloading updates"));
-    m_ui->timeLabel->setText(tr("Time remaining") + ": " + tr("unknown"));
-
-    /* Configure the network request */
-    QNetworkRequest request(url);
-
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                         QNetworkRequest::NoLessSafeRedirectPolicy);
-
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
-    /* 10s timeout */
-    request.setTransferTimeout(10000);
-#endif
-
-    if (!m_userAgentString.isEmpty())
-        request.setRawHeader("User-Agent", m_userAgentString.toUtf8());
-
-    /* Start download */
-    m_reply = m_manager->get(request);
-    m_startTime = QDateTime::currentDateTime().toSecsSinceEpoch();
+    resetProgress();
+
+    /* Hand the settings over to the transfer thread along with the job */
+    ZTransfer *transfer = m_transfer;
+    QString dir = m_downloadDir.absolutePath();
+    QString fileName = m_fileName;
+    QString userAgent = m_userAgentString;
+    qint64 readBufferSize = m_readBufferSize;
+    int segmentCount = m_segmentCount;
+    qint64 rateLimit = m_rateLimit;
+    bool backgroundMode = m_backgroundMode;
+    ZWriteStrategy writeStrategy = m_writeStrategy;
+    bool metricsEnabled = m_metricsEnabled;
+    QByteArray expectedHash = m_expectedHash;
+    QUrl checksumsUrl = m_checksumsUrl;
+    QUrl blockIndexUrl = m_blockIndexUrl;
+    QUrl blockFileUrl = m_blockFileUrl;
+    QString seedFile = m_seedFile;
+    QUrl deltaUrl = m_deltaUrl;
+    QString baseFile = m_baseFile;
+    ZContentDecoder::Encoding compression = m_compression;
+
+    QMetaObject::invokeMethod(transfer, [=]() {
+        transfer->setDownloadDir(dir);
+        transfer->setFileName(fileName);
+        transfer->setUserAgentString(userAgent);
+        transfer->setReadBufferSize(readBufferSize);
+        transfer->setSegmentCount(segmentCount);
+        transfer->setRateLimit(rateLimit, backgroundMode);
+        transfer->setWriteStrategy(writeStrategy);
+        transfer->setMetricsEnabled(metricsEnabled);
+        transfer->setExpectedHash(expectedHash);
+        transfer->setChecksumsUrl(checksumsUrl);
+        transfer->setBlockIndex(blockIndexUrl, seedFile, blockFileUrl);
+        transfer->setDelta(deltaUrl, baseFile);
+        transfer->setCompression(compression);
+        transfer->start(url);
+    });
 
-    /* Ensure that downloads directory exists */
-    if (!m_downloadDir.exists())
-        m_downloadDir.mkpath(".");
+    showNormal();
+}
 
-    /* Remove old downloads */
-    QFile::remove(m_downloadDir.filePath(m_fileName));
-    QFile::remove(m_downloadDir.filePath(m_fileName + PARTIAL_DOWN));
+/**
+ * Shows the progress of all the downloads in \a queue as one, and starts
+ * it. downloadFinished() is emitted for every file, the update is installed
+ * (from the first file) once all of them have been downloaded.
+ */
+void ZDownloader::startDownloads(ZDownloadQueue *queue)
+{
+    resetProgress();
 
-    /* Update UI when download progress changes or download finishes */
-    connect(m_reply, SIGNAL(metaDataChanged()), this, SLOT(metaDataChanged()));
-    connect(m_reply, SIGNAL(downloadProgress(qint64, qint64)), this,
+    m_queue = queue;
+    connect(queue, SIGNAL(progress(qint64, qint64)), this,
             SLOT(updateProgress(qint64, qint64)));
-    // call finished with the original URL when reply finishes
-    connect(m_reply, &QNetworkReply::finished, this,
-            [this, url]() { finished(url); });
-
+    connect(queue, SIGNAL(finished()), this, SLOT(queueFinished()));
+    connect(queue, &ZDownloadQueue::downloadFinished, this,
+            [this, queue](int id, const QString &filePath) {
+                QVariantMap profile = queue->downloadProfile(id);
+                emit downloadFinished(
+                    QUrl(profile.value("browser_download_url").toString()),
+                    filePath);
+            });
+
+    queue->start();
     showNormal();
 }
 
+/**
+ * Skips the download and goes straight to installing \a filePath, an update
+ * that was downloaded (and verified) from \a url earlier
+ */
+void ZDownloader::installDownload(const QUrl &url, const QString &filePath)
+{
+    setDownloadDir(QFileInfo(filePath).absolutePath());
+    finished(url, filePath);
+}
+
 /**
  * Changes the name of the downloaded file
  */
@@ -132,6 +224,56 @@ void ZDownloader::setFileName(const QString &file)
         m_fileName = "ZUpdate.bin";
 }
 
+/**
+ * Sets the SHA-256 (hex encoded) that the downloaded file must have.
+ * downloadFinished() is only emitted if the file matches it.
+ */
+void ZDownloader::setExpectedHash(const QByteArray &sha256)
+{
+    m_expectedHash = sha256;
+}
+
+/**
+ * Sets the URL of a SHA256SUMS style list that contains the checksum of the
+ * downloaded file. It is fetched in parallel with the download and only used
+ * if no hash was given with setExpectedHash().
+ */
+void ZDownloader::setChecksumsUrl(const QUrl &url) { m_checksumsUrl = url; }
+
+/**
+ * Sets the URL of the block index (a zsync file) of the download and the
+ * local copy of the previous version. When both are available, only the
+ * blocks that differ from \a seedFile are downloaded, from \a fileUrl if
+ * the download itself is compressed.
+ */
+void ZDownloader::setBlockIndex(const QUrl &url, const QString &seedFile,
+                                const QUrl &fileUrl)
+{
+    m_blockIndexUrl = url;
+    m_blockFileUrl = fileUrl;
+    m_seedFile = seedFile;
+}
+
+/**
+ * Sets the URL of a binary patch from \a baseFile (the installed version)
+ * to the download. The patch is tried first, the whole file is downloaded
+ * if it can't be applied.
+ */
+void ZDownloader::setDelta(const QUrl &url, const QString &baseFile)
+{
+    m_deltaUrl = url;
+    m_baseFile = baseFile;
+}
+
+/**
+ * Declares that the file at the download URL is compressed with
+ * \a encoding, it is decompressed while it downloads
+ */
+void ZDownloader::setCompression(ZContentDecoder::Encoding encoding)
+{
+    m_compression = encoding;
+}
+
 /**
  * Changes the user-agent string used to communicate with the remote HTTP server
  */
@@ -140,26 +282,77 @@ void ZDownloader::setUserAgentString(const QString &agent)
     m_userAgentString = agent;
 }
 
-void ZDownloader::finished(const QUrl &url)
+/**
+ * Called when the transfer thread has verified and renamed the download
+ */
+void ZDownloader::finished(const QUrl &url, const QString &filePath)
 {
-    if (m_reply->error() != QNetworkReply::NoError) {
-        QFile::remove(m_downloadDir.filePath(m_fileName + PARTIAL_DOWN));
+    m_running = false;
+    stopRendering();
+    m_fileName = QFileInfo(filePath).fileName();
+
+    /* Notify application */
+    emit downloadFinished(url, filePath);
+
+    /* Install the update */
+    installUpdate();
+    setVisible(false);
+}
+
+void ZDownloader::failed(const QString &error)
+{
+    m_running = false;
+    stopRendering();
+    m_ui->stopButton->setText(tr("Close"));
+    m_ui->downloadLabel->setText(tr("Download failed"));
+    m_ui->timeLabel->setText(error);
+
+    emit downloadFailed(error);
+}
+
+/**
+ * Called when every download of the queue has finished or failed
+ */
+void ZDownloader::queueFinished()
+{
+    if (!m_queue)
         return;
+
+    QList<int> ids = m_queue->ids();
+    for (int id : std::as_const(ids)) {
+        QString error = m_queue->errorString(id);
+        if (!error.isEmpty())
+            return failed(error);
     }
 
-    /* Rename file */
-    QFile::rename(m_downloadDir.filePath(m_fileName + PARTIAL_DOWN),
-                  m_downloadDir.filePath(m_fileName));
+    m_running = false;
+    stopRendering();
 
-    /* Notify application */
-    emit downloadFinished(url, m_downloadDir.filePath(m_fileName));
+    /* The first file is the one that gets installed */
+    if (!ids.isEmpty()) {
+        QFileInfo info(m_queue->filePath(ids.first()));
+        m_downloadDir.setPath(info.absolutePath());
+        m_fileName = info.fileName();
+    }
 
-    /* Install the update */
-    m_reply->close();
     installUpdate();
     setVisible(false);
 }
 
+void ZDownloader::retrying(int attempt)
+{
+    Q_UNUSED(attempt);
+    m_ui->timeLabel->setText(tr("Connection lost, retrying") + "...");
+}
+
+void ZDownloader::publishMetrics(const ZMetrics &result)
+{
+    if (!m_metricsFile.isEmpty() && !result.appendTo(m_metricsFile))
+        qWarning() << "ZDownloader: cannot write metrics to" << m_metricsFile;
+
+    emit metrics(result);
+}
+
 /**
  * Opens the downloaded file.
  * \note If the downloaded file is not found, then the function will alert the
@@ -228,7 +421,7 @@ void ZDownloader::installUpdate()
  */
 void ZDownloader::cancelDownload()
 {
-    if (!m_reply->isFinished()) {
+    if (m_running) {
         QMessageBox box;
         box.setWindowTitle(tr("Updater"));
         box.setIcon(QMessageBox::Question);
@@ -239,7 +432,13 @@ void ZDownloader::cancelDownload()
 
         if (box.exec() == QMessageBox::Yes) {
             hide();
-            m_reply->abort();
+            m_running = false;
+            stopRendering();
+            QMetaObject::invokeMethod(m_transfer, "abort",
+                                      Qt::QueuedConnection);
+            if (m_queue)
+                m_queue->abort();
+            emit downloadFailed(tr("Download cancelled"));
         }
     } else {
         hide();
@@ -247,26 +446,31 @@ void ZDownloader::cancelDownload()
 }
 
 /**
- * Writes the downloaded data to the disk
+ * Clears the progress of the previous download and starts rendering
  */
-void ZDownloader::saveFile(qint64 received, qint64 total)
+void ZDownloader::resetProgress()
 {
-    Q_UNUSED(received);
-    Q_UNUSED(total);
-
-    /* Check if we need to redirect */
-    QUrl url =
-        m_reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
-    if (!url.isEmpty()) {
-        startDownload(url);
-        return;
-    }
+    /* Reset UI */
+    m_ui->progressBar->setValue(0);
+    m_ui->stopButton->setText(tr("Stop"));
+    m_ui->downloadLabel->setText(tr("Downloading updates"));
+    m_ui->timeLabel->setText(tr("Time remaining") + ": " + tr("unknown"));
 
-    /* Save downloaded data to disk */
-    QFile file(m_downloadDir.filePath(m_fileName + PARTIAL_DOWN));
-    if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
-        file.write(m_reply->readAll());
-        file.close();
+    m_running = true;
+    m_progressDirty = false;
+    m_renderedTotal = -1;
+    m_repaints = 0;
+    m_sampleTime = -1;
+    m_speed = 0;
+    m_speedClock.start();
+    m_renderTimer.start();
+
+    /* With metrics enabled, count the repaints of the progress widgets
+     * during the download, see stopRendering() */
+    if (m_metricsEnabled) {
+        m_ui->progressBar->installEventFilter(this);
+        m_ui->downloadLabel->installEventFilter(this);
+        m_ui->timeLabel->installEventFilter(this);
     }
 }
 
@@ -277,94 +481,119 @@ void ZDownloader::saveFile(qint64 received, qint64 total)
  */
 void ZDownloader::calculateSizes(qint64 received, qint64 total)
 {
-    QString totalSize;
-    QString receivedSize;
+    QString receivedSize = formatSize(received);
 
-    if (total < 1024)
-        totalSize = tr("%1 bytes").arg(total);
+    /* Chunked or compressed responses do not announce their size */
+    if (total <= 0) {
+        m_ui->downloadLabel->setText(tr("Downloading updates") + " (" +
+                                     receivedSize + ")");
+        return;
+    }
 
-    else if (total < 1048576)
-        totalSize = tr("%1 KB").arg(round(total / 1024));
+    m_ui->downloadLabel->setText(tr("Downloading updates") + " (" +
+                                 receivedSize + " " + tr("of") + " " +
+                                 formatSize(total) + ")");
+}
 
-    else
-        totalSize = tr("%1 MB").arg(round(total / 1048576));
+/**
+ * Returns \a bytes in the largest unit that keeps the number above 1, with
+ * one decimal for megabytes and gigabytes
+ */
+QString ZDownloader::formatSize(qint64 bytes) const
+{
+    QLocale locale;
 
-    if (received < 1024)
-        receivedSize = tr("%1 bytes").arg(received);
+    if (bytes < 1024)
+        return tr("%1 bytes").arg(bytes);
 
-    else if (received < 1048576)
-        receivedSize = tr("%1 KB").arg(received / 1024);
+    else if (bytes < 1048576)
+        return tr("%1 KB").arg(qRound64(bytes / 1024.0));
 
-    else
-        receivedSize = tr("%1 MB").arg(received / 1048576);
+    else if (bytes < 1073741824)
+        return tr("%1 MB").arg(locale.toString(bytes / 1048576.0, 'f', 1));
 
-    m_ui->downloadLabel->setText(tr("Downloading updates") + " (" +
-                                 receivedSize + " " + tr("of") + " " +
-                                 totalSize + ")");
+    return tr("%1 GB").arg(locale.toString(bytes / 1073741824.0, 'f', 1));
 }
 
 /**
- * Get response filename.
+ * Records the progress reported by the transfer and updates the speed
+ * estimate. The dialog is redrawn by renderProgress().
  */
-void ZDownloader::metaDataChanged()
-{
-    QString filename = "";
-    QVariant variant =
-        m_reply->header(QNetworkRequest::ContentDispositionHeader);
-    if (variant.isValid()) {
-        QString contentDisposition =
-            QByteArray::fromPercentEncoding(variant.toByteArray()).constData();
-        QRegularExpression regExp(R"(filename=(\S+))");
-        QRegularExpressionMatch match = regExp.match(contentDisposition);
-        if (match.hasMatch()) {
-            filename = match.captured(1);
-        }
-        setFileName(filename);
+void ZDownloader::updateProgress(qint64 received, qint64 total)
+{
+    qint64 now = m_speedClock.elapsed();
+
+    /* Data we already had when resuming does not count for the speed */
+    if (m_sampleTime < 0) {
+        m_sampleTime = now;
+        m_sampleBytes = received;
+    } else if (now > m_sampleTime) {
+        qreal dt = now - m_sampleTime;
+        qreal speed = (received - m_sampleBytes) * 1000.0 / dt;
+
+        /* The weight depends on the time since the last sample, so bursts
+         * of notifications don't skew the average */
+        if (m_speed <= 0)
+            m_speed = speed;
+        else
+            m_speed += (1 - exp(-dt / SPEED_TAU_MS)) * (speed - m_speed);
+
+        m_sampleTime = now;
+        m_sampleBytes = received;
     }
+
+    m_received = received;
+    m_total = total;
+    m_progressDirty = true;
+
+    /* Don't make the user wait for the last frame */
+    if (total > 0 && received >= total)
+        renderProgress();
 }
 
 /**
- * Uses the \a received and \a total parameters to get the download progress
- * and update the progressbar value on the dialog.
+ * Draws the latest progress on the dialog, called at most every
+ * RenderInterval milliseconds
  */
-void ZDownloader::updateProgress(qint64 received, qint64 total)
+void ZDownloader::renderProgress()
 {
-    if (total > 0) {
-        m_ui->progressBar->setMinimum(0);
-        m_ui->progressBar->setMaximum(100);
-        m_ui->progressBar->setValue((received * 100) / total);
+    if (!m_progressDirty)
+        return;
 
-        calculateSizes(received, total);
-        calculateTimeRemaining(received, total);
-        saveFile(received, total);
+    m_progressDirty = false;
+
+    /* Switching between a known and an unknown size changes the mode of
+     * the progress bar, which is expensive, so only do it when needed */
+    bool known = m_total > 0;
+    if (m_renderedTotal < 0 || known != (m_renderedTotal > 0)) {
+        m_ui->progressBar->setRange(0, known ? 100 : 0);
+        if (!known) {
+            m_ui->progressBar->setValue(-1);
+            m_ui->timeLabel->setText(QString("%1: %2")
+                                         .arg(tr("Time Remaining"))
+                                         .arg(tr("Unknown")));
+        }
     }
+    m_renderedTotal = m_total;
 
-    else {
-        m_ui->progressBar->setMinimum(0);
-        m_ui->progressBar->setMaximum(0);
-        m_ui->progressBar->setValue(-1);
-        m_ui->downloadLabel->setText(tr("Downloading Updates") + "...");
-        m_ui->timeLabel->setText(
-            QString("%1: %2").arg(tr("Time Remaining")).arg(tr("Unknown")));
-    }
+    calculateSizes(m_received, m_total);
+    if (!known)
+        return;
+
+    m_ui->progressBar->setValue(int((m_received * 100) / m_total));
+    calculateTimeRemaining(m_total - m_received);
 }
 
 /**
- * Uses two time samples (from the current time and a previous sample) to
- * calculate how many bytes have been downloaded.
- *
- * Then, this function proceeds to calculate the appropiate units of time
- * (hours, minutes or seconds) and constructs a user-friendly string, which
- * is displayed in the dialog.
+ * Uses the estimated download speed to calculate the appropiate units of
+ * time (hours, minutes or seconds) for the \a remaining bytes and
+ * constructs a user-friendly string, which is displayed in the dialog.
  */
-void ZDownloader::calculateTimeRemaining(qint64 received, qint64 total)
+void ZDownloader::calculateTimeRemaining(qint64 remaining)
 {
-    uint difference =
-        QDateTime::currentDateTime().toSecsSinceEpoch() - m_startTime;
-
-    if (difference > 0) {
+    if (m_speed > 0) {
         QString timeString;
-        qreal timeRemaining = (total - received) / (received / difference);
+        qreal timeRemaining = remaining / m_speed;
 
         if (timeRemaining > 7200) {
             timeRemaining /= 3600;
@@ -400,11 +629,34 @@ void ZDownloader::calculateTimeRemaining(qint64 received, qint64 total)
 }
 
 /**
- * Rounds the given \a input to two decimal places
+ * Stops redrawing the progress. With metrics enabled, logs how often the
+ * progress widgets were painted during the download.
  */
-qreal ZDownloader::round(const qreal &input)
+void ZDownloader::stopRendering()
+{
+    if (!m_renderTimer.isActive())
+        return;
+
+    renderProgress();
+    m_renderTimer.stop();
+
+    m_ui->progressBar->removeEventFilter(this);
+    m_ui->downloadLabel->removeEventFilter(this);
+    m_ui->timeLabel->removeEventFilter(this);
+    if (!m_metricsEnabled)
+        return;
+
+    qreal gb = qMax<qreal>(m_received / 1073741824.0, 1.0 / 1073741824);
+    qDebug() << "ZDownloader:" << m_repaints << "progress repaints,"
+             << m_repaints / gb << "per GB";
+}
+
+bool ZDownloader::eventFilter(QObject *watched, QEvent *event)
 {
-    return static_cast<qreal>(roundf(static_cast<float>(input) * 100) / 100);
+    if (event->type() == QEvent::Paint)
+        ++m_repaints;
+
+    return QWidget::eventFilter(watched, event);
 }
 
 QString ZDownloader::downloadDir() const
@@ -412,6 +664,86 @@ QString ZDownloader::downloadDir() const
     return m_downloadDir.absolutePath();
 }
 
+int ZDownloader::segmentCount() const { return m_segmentCount; }
+
+/**
+ * Downloads files over \a count concurrent connections, each one fetching a
+ * byte range of the file. A count of 1 (the default) uses a single stream,
+ * which is also used when the server does not support range requests.
+ */
+void ZDownloader::setSegmentCount(int count)
+{
+    m_segmentCount = qBound(1, count, 16);
+}
+
+qint64 ZDownloader::rateLimit() const { return m_rateLimit; }
+
+/**
+ * Limits the download to \a bytesPerSecond, 0 (the default) downloads as
+ * fast as the link allows. A limited download uses a single connection.
+ */
+void ZDownloader::setRateLimit(qint64 bytesPerSecond)
+{
+    m_rateLimit = qMax<qint64>(bytesPerSecond, 0);
+}
+
+bool ZDownloader::isBackgroundMode() const { return m_backgroundMode; }
+
+/**
+ * Downloads at low priority: the rate starts low and keeps backing off
+ * whenever the round trip time to the server grows, which means the
+ * download is filling the link. The rate limit, if set, is the ceiling.
+ */
+void ZDownloader::setBackgroundMode(bool background)
+{
+    m_backgroundMode = background;
+}
+
+ZWriteStrategy ZDownloader::writeStrategy() const { return m_writeStrategy; }
+
+/**
+ * Changes how the download is written to disk: the size of the writes,
+ * whether the disk space is claimed up front and whether the file is synced
+ * before it is renamed. Takes effect on the next download.
+ */
+void ZDownloader::setWriteStrategy(const ZWriteStrategy &strategy)
+{
+    m_writeStrategy = strategy;
+}
+
+bool ZDownloader::isMetricsEnabled() const { return m_metricsEnabled; }
+
+QString ZDownloader::metricsFile() const { return m_metricsFile; }
+
+/**
+ * Emits metrics() with the timing breakdown of each download, see ZMetrics.
+ * Takes effect on the next download.
+ */
+void ZDownloader::setMetricsEnabled(bool enabled)
+{
+    m_metricsEnabled = enabled;
+}
+
+/**
+ * Also appends the metrics to \a path, one line of JSON per download
+ */
+void ZDownloader::setMetricsFile(const QString &path) { m_metricsFile = path; }
+
+qint64 ZDownloader::readBufferSize() const { return m_readBufferSize; }
+
+/**
+ * Limits the amount of downloaded data that may be held in memory before it
+ * is written to disk. Once the limit is reached, Qt stops reading from the
+ * socket until the file sink has drained the reply, so memory usage stays
+ * flat no matter how large the download is (or whether its size is known).
+ *
+ * A \a size of 0 removes the limit. Takes effect on the next download.
+ */
+void ZDownloader::setReadBufferSize(qint64 size)
+{
+    m_readBufferSize = qMax<qint64>(size, 0);
+}
+
 void ZDownloader::setDownloadDir(const QString &downloadDir)
 {
     if (m_downloadDir.absolutePath() != downloadDir)
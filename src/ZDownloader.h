@@ -24,10 +24,17 @@
 #ifndef DOWNLOAD_DIALOG_H
 #define DOWNLOAD_DIALOG_H
 
+#include "ZContentDecoder.h"
+#include "ZFileSink.h"
+#include "ZMetrics.h"
 #include "ui_ZDownloader.h"
 #include <QDialog>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QString>
+#include <QTimer>
+#include <QUrl>
 
 struct UpdateProcedure {
     bool openFile;
@@ -37,10 +44,10 @@ struct UpdateProcedure {
     QString boxText;
 };
 
-class QAuthenticator;
-class QNetworkReply;
-class QNetworkAccessManager;
 class QDialog;
+class ZTransfer;
+class ZDownloadQueue;
+class ZNetworkContext;
 namespace Ui
 {
 class ZDownloader;
@@ -52,42 +59,115 @@ class ZDownloader : public QWidget
 
 signals:
     void downloadFinished(const QUrl &url, const QString &filepath);
+    void downloadFailed(const QString &error);
+    void metrics(const ZMetrics &metrics);
 
 public:
     explicit ZDownloader(UpdateProcedure updateProcedure, QWidget *parent = 0);
+    ZDownloader(UpdateProcedure updateProcedure, ZNetworkContext *network,
+                QWidget *parent = 0);
     ~ZDownloader();
 
+    static constexpr qint64 DefaultReadBufferSize = 1024 * 1024;
+    static constexpr int RenderInterval = 100;
+
     QString downloadDir() const;
     void setDownloadDir(const QString &downloadDir);
 
+    qint64 readBufferSize() const;
+    void setReadBufferSize(qint64 size);
+
+    int segmentCount() const;
+    void setSegmentCount(int count);
+
+    qint64 rateLimit() const;
+    bool isBackgroundMode() const;
+    void setRateLimit(qint64 bytesPerSecond);
+    void setBackgroundMode(bool background);
+
+    ZWriteStrategy writeStrategy() const;
+    void setWriteStrategy(const ZWriteStrategy &strategy);
+
+    bool isMetricsEnabled() const;
+    QString metricsFile() const;
+    void setMetricsEnabled(bool enabled);
+    void setMetricsFile(const QString &path);
+
 public slots:
     void startDownload(const QUrl &url);
+    void startDownloads(ZDownloadQueue *queue);
+    void installDownload(const QUrl &url, const QString &filePath);
     void setFileName(const QString &file);
     void setUserAgentString(const QString &agent);
+    void setExpectedHash(const QByteArray &sha256);
+    void setChecksumsUrl(const QUrl &url);
+    void setBlockIndex(const QUrl &url, const QString &seedFile,
+                       const QUrl &fileUrl = QUrl());
+    void setDelta(const QUrl &url, const QString &baseFile);
+    void setCompression(ZContentDecoder::Encoding encoding);
 
 private slots:
-    void finished(const QUrl &url);
-    void metaDataChanged();
+    void finished(const QUrl &url, const QString &filePath);
+    void failed(const QString &error);
+    void queueFinished();
+    void retrying(int attempt);
+    void publishMetrics(const ZMetrics &result);
     void openDownload();
     void installUpdate();
     void cancelDownload();
-    void saveFile(qint64 received, qint64 total);
-    void calculateSizes(qint64 received, qint64 total);
     void updateProgress(qint64 received, qint64 total);
-    void calculateTimeRemaining(qint64 received, qint64 total);
+    void renderProgress();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private:
-    qreal round(const qreal &input);
+    void resetProgress();
+    void calculateSizes(qint64 received, qint64 total);
+    void calculateTimeRemaining(qint64 remaining);
+    QString formatSize(qint64 bytes) const;
+    void stopRendering();
     UpdateProcedure m_updateProcedure;
 
 private:
-    uint m_startTime;
+    bool m_running;
     QDir m_downloadDir;
     QString m_fileName;
     Ui::ZDownloader *m_ui;
-    QNetworkReply *m_reply;
     QString m_userAgentString;
-    QNetworkAccessManager *m_manager;
+
+    qint64 m_readBufferSize;
+    int m_segmentCount;
+    qint64 m_rateLimit;
+    bool m_backgroundMode;
+    ZWriteStrategy m_writeStrategy;
+    bool m_metricsEnabled;
+    QString m_metricsFile;
+    QUrl m_checksumsUrl;
+    QByteArray m_expectedHash;
+    QUrl m_blockIndexUrl;
+    QUrl m_blockFileUrl;
+    QString m_seedFile;
+    QUrl m_deltaUrl;
+    QString m_baseFile;
+    ZContentDecoder::Encoding m_compression;
+
+    QPointer<ZTransfer> m_transfer;
+    QPointer<ZDownloadQueue> m_queue;
+
+    // Latest progress, drawn at most every RenderInterval milliseconds
+    QTimer m_renderTimer;
+    bool m_progressDirty;
+    qint64 m_received;
+    qint64 m_total;
+    qint64 m_renderedTotal;
+    qint64 m_repaints;
+
+    // Download speed, an exponentially weighted moving average
+    QElapsedTimer m_speedClock;
+    qint64 m_sampleTime;
+    qint64 m_sampleBytes;
+    qreal m_speed;
 };
 
 #endif
\ No newline at end of file
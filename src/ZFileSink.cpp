@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZFileSink.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QStorageInfo>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* Left free on the disk on top of the download */
+static const qint64 DISK_SPACE_MARGIN = 16 * 1024 * 1024;
+
+ZFileSink::ZFileSink(qint64 bufferSize)
+    : m_used(0), m_fill(0), m_offset(0), m_hashing(false),
+      m_hash(QCryptographicHash::Sha256), m_bytesWritten(0), m_writeCalls(0),
+      m_writeTime(0), m_hashTime(0)
+{
+    m_buffer.resize(qMax<qint64>(bufferSize, 4096));
+    m_fill = m_buffer.size();
+}
+
+ZFileSink::~ZFileSink() { close(); }
+
+/**
+ * Writes the data in chunks of \a size bytes (4 KiB at least). Buffered data
+ * is written out first.
+ */
+void ZFileSink::setBufferSize(qint64 size)
+{
+    size = qMax<qint64>(size, 4096);
+    if (size == m_buffer.size())
+        return;
+
+    flushBuffer();
+    m_buffer.resize(size);
+    m_fill = size - (m_offset + m_bytesWritten) % size;
+}
+
+QString ZFileSink::errorString() const
+{
+    return m_error.isEmpty() ? m_file.errorString() : m_error;
+}
+
+/**
+ * Opens the file at \a path and truncates it to \a offset bytes, so that new
+ * data is appended after the first \a offset bytes (0 starts a new file).
+ * The file stays open until close() is called, regardless of how many chunks
+ * are written to it.
+ *
+ * When hashing is enabled, the first \a offset bytes are read back once so
+ * that hash() covers the whole file.
+ */
+bool ZFileSink::open(const QString &path, qint64 offset)
+{
+    close();
+
+    m_used = 0;
+    m_offset = offset;
+    m_error.clear();
+    m_bytesWritten = 0;
+    m_writeCalls = 0;
+    m_writeTime = 0;
+    m_hashTime = 0;
+    m_hash.reset();
+
+    /* We do our own buffering, so skip the QIODevice write buffer */
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Unbuffered))
+        return false;
+
+    /* Hash the data we are going to keep */
+    qint64 remaining = offset;
+    while (m_hashing && remaining > 0) {
+        qint64 read = m_file.read(m_buffer.data(),
+                                  qMin<qint64>(remaining, m_buffer.size()));
+        if (read <= 0)
+            break;
+
+        m_hash.addData(QByteArrayView(m_buffer.constData(), read));
+        remaining -= read;
+    }
+
+    if ((m_hashing && remaining > 0) || !m_file.resize(offset) ||
+        !m_file.seek(offset)) {
+        m_file.close();
+        return false;
+    }
+
+    /* Fill the buffer up to the next aligned position first */
+    m_fill = m_buffer.size() - offset % m_buffer.size();
+    return true;
+}
+
+/**
+ * Writes any buffered data to disk and closes the file
+ */
+void ZFileSink::close()
+{
+    if (!m_file.isOpen())
+        return;
+
+    flushBuffer();
+    m_file.close();
+}
+
+/**
+ * Hands the buffered data to the OS
+ */
+bool ZFileSink::flush() { return flushBuffer(); }
+
+/**
+ * Drains all the data currently available in \a source into the file, using
+ * the sink buffer as the only intermediate storage. At most \a maxSize bytes
+ * are consumed unless it is negative.
+ *
+ * Returns the number of bytes consumed from \a source, or -1 on error.
+ */
+qint64 ZFileSink::write(QIODevice *source, qint64 maxSize)
+{
+    if (!m_file.isOpen() || !source)
+        return -1;
+
+    qint64 consumed = 0;
+    forever {
+        qint64 space = m_fill - m_used;
+        if (maxSize >= 0)
+            space = qMin(space, maxSize - consumed);
+        if (space <= 0)
+            break;
+
+        qint64 read = source->read(m_buffer.data() + m_used, space);
+        if (read < 0)
+            return -1;
+        if (read == 0)
+            break;
+
+        m_used += read;
+        consumed += read;
+
+        if (m_used == m_fill && !flushBuffer())
+            return -1;
+    }
+
+    return consumed;
+}
+
+/**
+ * Appends \a size bytes from \a data to the file
+ */
+bool ZFileSink::write(const char *data, qint64 size)
+{
+    if (!m_file.isOpen())
+        return false;
+
+    while (size > 0) {
+        qint64 chunk = qMin(size, m_fill - m_used);
+        memcpy(m_buffer.data() + m_used, data, size_t(chunk));
+        m_used += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (m_used == m_fill && !flushBuffer())
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Claims the disk space for a file of \a size bytes, see preallocate()
+ */
+bool ZFileSink::reserve(qint64 size)
+{
+    if (!m_file.isOpen())
+        return false;
+
+    return preallocate(m_file, size, &m_error);
+}
+
+bool ZFileSink::flushBuffer()
+{
+    if (m_used == 0)
+        return true;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 written = m_file.write(m_buffer.constData(), m_used);
+    ++m_writeCalls;
+    m_writeTime += timer.nsecsElapsed();
+    if (written != m_used)
+        return false;
+
+    if (m_hashing) {
+        timer.start();
+        m_hash.addData(QByteArrayView(m_buffer.constData(), m_used));
+        m_hashTime += timer.nsecsElapsed();
+    }
+
+    m_bytesWritten += written;
+    m_used = 0;
+    m_fill = m_buffer.size();
+    return true;
+}
+
+/**
+ * Makes sure there is room for \a file to grow to \a size bytes. Fails
+ * right away if the disk doesn't have that much free space.
+ *
+ * On Linux the blocks are allocated as well, so the file is laid out in one
+ * piece instead of growing with every write. The visible size of the file
+ * doesn't change: a download interrupted by a crash never looks longer than
+ * the data that made it to disk. Filesystems that can't allocate ahead of
+ * time are only checked for free space.
+ */
+bool ZFileSink::preallocate(QFile &file, qint64 size, QString *error)
+{
+    qint64 needed = size - file.size();
+    if (needed <= 0)
+        return true;
+
+    QStorageInfo storage(QFileInfo(file).absolutePath());
+    qint64 available = storage.bytesAvailable();
+    if (storage.isValid() && available >= 0 &&
+        available < needed + DISK_SPACE_MARGIN) {
+        *error = QCoreApplication::translate(
+                     "ZFileSink",
+                     "Not enough disk space: %1 MB needed, %2 MB free")
+                     .arg((needed + DISK_SPACE_MARGIN) >> 20)
+                     .arg(available >> 20);
+        return false;
+    }
+
+#if defined(Q_OS_LINUX)
+    if (fallocate(file.handle(), FALLOC_FL_KEEP_SIZE, 0, size) != 0 &&
+        errno == ENOSPC) {
+        *error = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+/**
+ * Replaces \a target with the finished \a partFile in a single step. With
+ * \a sync, the data is flushed to stable storage first (and the rename
+ * after it), so that a crash can't leave a truncated file under the final
+ * name.
+ */
+bool ZFileSink::commit(const QString &partFile, const QString &target,
+                       bool sync, QString *error)
+{
+    if (sync) {
+        QFile file(partFile);
+        if (!file.open(QIODevice::ReadWrite)) {
+            *error = file.errorString();
+            return false;
+        }
+
+#if defined(Q_OS_WIN)
+        bool synced = _commit(file.handle()) == 0;
+#elif defined(Q_OS_UNIX)
+        bool synced = fsync(file.handle()) == 0;
+#else
+        bool synced = true;
+#endif
+        if (!synced) {
+            *error = QString::fromLocal8Bit(strerror(errno));
+            return false;
+        }
+    }
+
+#if defined(Q_OS_WIN)
+    DWORD flags = MOVEFILE_REPLACE_EXISTING;
+    if (sync)
+        flags |= MOVEFILE_WRITE_THROUGH;
+    QString from = QDir::toNativeSeparators(partFile);
+    QString to = QDir::toNativeSeparators(target);
+    if (!MoveFileExW(reinterpret_cast<LPCWSTR>(from.utf16()),
+                     reinterpret_cast<LPCWSTR>(to.utf16()), flags)) {
+        *error = qt_error_string(int(GetLastError()));
+        return false;
+    }
+#elif defined(Q_OS_UNIX)
+    /* rename() atomically replaces the target */
+    if (::rename(QFile::encodeName(partFile).constData(),
+                 QFile::encodeName(target).constData()) != 0) {
+        *error = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    /* The new directory entry has to reach the disk as well */
+    if (sync) {
+        QByteArray dir = QFile::encodeName(QFileInfo(target).absolutePath());
+        int fd = ::open(dir.constData(), O_RDONLY);
+        if (fd >= 0) {
+            fsync(fd);
+            ::close(fd);
+        }
+    }
+#else
+    QFile::remove(target);
+    if (!QFile::rename(partFile, target)) {
+        *error = QFile(partFile).errorString();
+        return false;
+    }
+#endif
+
+    return true;
+}
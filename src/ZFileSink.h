@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZFILE_SINK_H
+#define ZFILE_SINK_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QString>
+
+class QIODevice;
+
+/**
+ * Streams downloaded data into a file that stays open for the whole transfer.
+ *
+ * Incoming bytes are copied into a fixed-size buffer that is allocated once
+ * and only handed to the OS when it is full (or when the sink is flushed), so
+ * a download costs one write() per buffer instead of one open/write/close per
+ * network chunk. Writes start at multiples of the buffer size in the file,
+ * even when resuming at an arbitrary offset.
+ *
+ * reserve() claims the disk space for the whole file once its size is known,
+ * and commit() moves the finished file into place so that a crash leaves
+ * either the old file or the complete new one behind.
+ *
+ * When hashing is enabled, the SHA-256 of the file is computed from the same
+ * buffer right before it is written, so verifying the download does not
+ * require reading it back from disk.
+ */
+class ZFileSink
+{
+public:
+    static constexpr qint64 DefaultBufferSize = 256 * 1024;
+
+    explicit ZFileSink(qint64 bufferSize = DefaultBufferSize);
+    ~ZFileSink();
+
+    qint64 bufferSize() const { return m_buffer.size(); }
+    void setBufferSize(qint64 size);
+
+    bool open(const QString &path, qint64 offset = 0);
+    void close();
+    bool flush();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    qint64 write(QIODevice *source, qint64 maxSize = -1);
+    bool write(const char *data, qint64 size);
+    bool reserve(qint64 size);
+
+    bool isHashing() const { return m_hashing; }
+    void setHashing(bool enabled) { m_hashing = enabled; }
+    QByteArray hash() const { return m_hash.result(); }
+
+    QString fileName() const { return m_file.fileName(); }
+    QString errorString() const;
+
+    static bool preallocate(QFile &file, qint64 size, QString *error);
+    static bool commit(const QString &partFile, const QString &target,
+                       bool sync, QString *error);
+
+    // Statistics, reset by open(). Times are in nanoseconds.
+    qint64 bytesWritten() const { return m_bytesWritten; }
+    qint64 writeCalls() const { return m_writeCalls; }
+    qint64 writeTime() const { return m_writeTime; }
+    qint64 hashTime() const { return m_hashTime; }
+
+private:
+    bool flushBuffer();
+
+    QFile m_file;
+    QByteArray m_buffer;
+    qint64 m_used;
+    qint64 m_fill;
+    qint64 m_offset;
+    QString m_error;
+
+    bool m_hashing;
+    QCryptographicHash m_hash;
+
+    qint64 m_bytesWritten;
+    qint64 m_writeCalls;
+    qint64 m_writeTime;
+    qint64 m_hashTime;
+};
+
+/**
+ * How downloads are written to disk
+ */
+struct ZWriteStrategy {
+    // Size of the coalesced writes
+    qint64 bufferSize = ZFileSink::DefaultBufferSize;
+
+    // Claim the disk space for the whole file before writing to it, which
+    // fails early if there is not enough and keeps the file in one piece
+    bool preallocate = true;
+
+    // Flush the file to stable storage before renaming it into place
+    bool sync = true;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZMetrics.h"
+#include <QDateTime>
+#include <QFile>
+#include <QHostInfo>
+#include <QJsonDocument>
+#include <QNetworkReply>
+#include <memory>
+
+ZMetrics::ZMetrics(const QString &kind, const QUrl &url) : kind(kind), url(url)
+{
+}
+
+/**
+ * Records the connection phases of \a reply. The metrics must stay alive as
+ * long as \a context, which is usually the object that owns both.
+ */
+void ZMetrics::track(QNetworkReply *reply, QObject *context)
+{
+    ++requests;
+    const qint64 sent = clock.nsecsElapsed();
+
+    /* Only the first request pays for the lookup, later ones hit the cache */
+    QString host = reply->url().host();
+    if (requests == 1 && !host.isEmpty()) {
+        QHostInfo::lookupHost(host, context, [this, sent](const QHostInfo &) {
+            if (clock.isValid() && dnsTime < 0)
+                dnsTime = clock.nsecsElapsed() - sent;
+        });
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    auto connecting = std::make_shared<qint64>(-1);
+    QObject::connect(reply, &QNetworkReply::socketStartedConnecting, context,
+                     [this, connecting]() {
+                         *connecting = clock.nsecsElapsed();
+                     });
+    QObject::connect(reply, &QNetworkReply::requestSent, context,
+                     [this, connecting]() {
+                         if (*connecting >= 0 && connectTime < 0)
+                             connectTime = clock.nsecsElapsed() - *connecting;
+                         *connecting = -1;
+                     });
+#endif
+
+    QObject::connect(reply, &QNetworkReply::encrypted, context,
+                     [this]() { tls = true; });
+    QObject::connect(reply, &QNetworkReply::redirected, context,
+                     [this, sent]() {
+                         ++redirects;
+                         redirectTime = clock.nsecsElapsed() - sent;
+                     });
+    QObject::connect(reply, &QNetworkReply::metaDataChanged, context,
+                     [this, sent]() {
+                         if (ttfb < 0)
+                             ttfb = clock.nsecsElapsed() - sent;
+                     });
+}
+
+/**
+ * Stops the clock, the metrics are complete after this
+ */
+void ZMetrics::finish(bool succeeded, const QString &errorString)
+{
+    totalTime = clock.isValid() ? clock.nsecsElapsed() : -1;
+    ok = succeeded;
+    error = errorString;
+    clock.invalidate();
+}
+
+/**
+ * Returns the metrics with times in milliseconds, unknown values are left
+ * out
+ */
+QJsonObject ZMetrics::toJson() const
+{
+    QJsonObject json;
+    json.insert("time", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    json.insert("kind", kind);
+    json.insert("url", url.toString());
+    json.insert("ok", ok);
+    if (!error.isEmpty())
+        json.insert("error", error);
+
+    const QList<QPair<const char *, qint64>> times = {
+        {"dns_ms", dnsTime},      {"connect_ms", connectTime},
+        {"ttfb_ms", ttfb},        {"redirect_ms", redirectTime},
+        {"total_ms", totalTime},  {"parse_ms", parseTime},
+        {"write_ms", writeTime},  {"hash_ms", hashTime},
+        {"decode_ms", decodeTime}};
+    for (const auto &time : times) {
+        if (time.second >= 0)
+            json.insert(time.first, time.second / 1e6);
+    }
+
+    json.insert("requests", requests);
+    json.insert("redirects", redirects);
+    json.insert("bytes", bytes);
+    if (wireBytes >= 0)
+        json.insert("wire_bytes", wireBytes);
+    if (!encoding.isEmpty())
+        json.insert("encoding", encoding);
+    if (wireBytes > 0 && bytes > 0)
+        json.insert("ratio", qreal(bytes) / wireBytes);
+    if (decodeTime > 0)
+        json.insert("decode_bytes_per_s", qRound64(bytes * 1e9 / decodeTime));
+    json.insert("tls", tls);
+    json.insert("cached", cached);
+    if (totalTime > 0 && bytes > 0)
+        json.insert("bytes_per_s", qRound64(bytes * 1e9 / totalTime));
+
+    return json;
+}
+
+/**
+ * Appends the metrics to \a path as a single line of JSON
+ */
+bool ZMetrics::appendTo(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+
+    QByteArray line = QJsonDocument(toJson()).toJson(QJsonDocument::Compact);
+    return file.write(line + '\n') == line.size() + 1;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZMETRICS_H
+#define ZMETRICS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMetaType>
+#include <QString>
+#include <QUrl>
+
+class QObject;
+class QNetworkReply;
+
+/**
+ * Timing breakdown of an update check or a download.
+ *
+ * Times are in nanoseconds and -1 when unknown: the connection phases are
+ * only seen for the requests passed to track(), and a reused connection has
+ * no DNS or connect phase at all. Qt doesn't report the end of the TCP
+ * handshake, so "connect" covers everything from the socket starting to
+ * connect to the request being sent, including the TLS handshake when
+ * "tls" is set. The DNS time comes from a lookup of the same host made in
+ * parallel, which the socket's own lookup then shares.
+ *
+ * Collection is off unless enabled on ZUpdateClient, ZUpdater or ZDownloader,
+ * and costs a few signal connections per request when it is on.
+ */
+struct ZMetrics {
+    ZMetrics(const QString &kind = QString(), const QUrl &url = QUrl());
+
+    QString kind; // "check" or "download"
+    QUrl url;
+    QElapsedTimer clock;
+
+    qint64 dnsTime = -1;
+    qint64 connectTime = -1;
+    qint64 ttfb = -1;
+    qint64 redirectTime = -1;
+    qint64 totalTime = -1;
+    qint64 parseTime = -1;
+    qint64 writeTime = -1;
+    qint64 hashTime = -1;
+    qint64 decodeTime = -1;
+
+    int requests = 0;
+    int redirects = 0;
+    qint64 bytes = 0;
+    qint64 wireBytes = -1; // before decompression, -1 if not measured
+    QString encoding;      // Content-Encoding of the response
+    bool tls = false;
+    bool cached = false;
+    bool ok = false;
+    QString error;
+
+    void track(QNetworkReply *reply, QObject *context);
+    void finish(bool succeeded, const QString &errorString = QString());
+
+    QJsonObject toJson() const;
+    bool appendTo(const QString &path) const;
+};
+
+Q_DECLARE_METATYPE(ZMetrics)
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZNetworkContext.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QThread>
+
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+
+static QSslConfiguration sslConfiguration()
+{
+    QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+
+    /* Let the manager cache session tickets, so new connections to a host
+     * we have talked to before resume the TLS session */
+    config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    config.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
+    config.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2,
+                                    QSslConfiguration::NextProtocolHttp1_1});
+    return config;
+}
+#endif
+
+ZNetworkContext::ZNetworkContext(QObject *parent)
+    : QObject(parent), m_manager(new QNetworkAccessManager(this)),
+      m_transferManager(new QNetworkAccessManager),
+      m_transferThread(new QThread(this))
+{
+    m_transferThread->setObjectName("ZUpdater transfers");
+    m_transferManager->moveToThread(m_transferThread);
+    connect(m_transferThread, &QThread::finished, m_transferManager,
+            &QObject::deleteLater);
+    m_transferThread->start();
+}
+
+ZNetworkContext::~ZNetworkContext()
+{
+    m_transferThread->quit();
+    m_transferThread->wait();
+}
+
+/**
+ * Returns the context shared by default by all updaters and downloaders. It
+ * is created on first use and destroyed with the application object.
+ */
+ZNetworkContext *ZNetworkContext::instance()
+{
+    static QPointer<ZNetworkContext> shared;
+    if (!shared)
+        shared = new ZNetworkContext(QCoreApplication::instance());
+
+    return shared;
+}
+
+/**
+ * Applies the settings every request made through the context should use
+ */
+void ZNetworkContext::prepareRequest(QNetworkRequest &request)
+{
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#ifndef QT_NO_SSL
+    if (request.url().scheme() == "https")
+        request.setSslConfiguration(sslConfiguration());
+#endif
+}
+
+/**
+ * Prepares the transfer thread for downloading \a url: the redirect to the
+ * CDN is resolved with a HEAD request and a connection to the final host is
+ * opened, so a download started shortly after can send its request right
+ * away. Safe to call from any thread.
+ */
+void ZNetworkContext::prewarm(const QUrl &url)
+{
+    if (!url.isValid())
+        return;
+
+    QMetaObject::invokeMethod(m_transferManager,
+                              [this, url]() { prewarmInTransferThread(url); });
+}
+
+void ZNetworkContext::prewarmInTransferThread(const QUrl &url)
+{
+    QNetworkRequest request(url);
+    prepareRequest(request);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                         QNetworkRequest::ManualRedirectPolicy);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QNetworkReply *reply = m_transferManager->head(request);
+    connect(reply, &QNetworkReply::finished, m_transferManager,
+            [this, reply, url, timer]() {
+                reply->deleteLater();
+
+                QUrl target =
+                    reply->attribute(QNetworkRequest::RedirectionTargetAttribute)
+                        .toUrl();
+                qDebug() << "ZNetworkContext: prewarmed" << url.host() << "in"
+                         << timer.elapsed() << "ms";
+
+                if (target.isValid())
+                    connectToHost(url.resolved(target));
+            });
+}
+
+void ZNetworkContext::connectToHost(const QUrl &url)
+{
+    qDebug() << "ZNetworkContext: connecting to" << url.host();
+
+#ifndef QT_NO_SSL
+    if (url.scheme() == "https") {
+        m_transferManager->connectToHostEncrypted(
+            url.host(), quint16(url.port(443)), sslConfiguration());
+        return;
+    }
+#endif
+
+    m_transferManager->connectToHost(url.host(), quint16(url.port(80)));
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZNETWORK_CONTEXT_H
+#define ZNETWORK_CONTEXT_H
+
+#include <QObject>
+#include <QUrl>
+
+class QThread;
+class QNetworkRequest;
+class QNetworkAccessManager;
+
+/**
+ * Network stack shared by the updater and its downloads.
+ *
+ * A QNetworkAccessManager can only be used from the thread it lives in, so
+ * the context holds two of them: one in the thread that created the context
+ * for the release checks, and one in a single transfer thread that runs
+ * every download. Both keep their connection pools and TLS session caches
+ * for as long as the context lives, so subsequent checks and downloads skip
+ * the DNS, TCP and TLS handshakes whenever the server allows it.
+ *
+ * Requests should go through prepareRequest() to enable HTTP/2 and TLS
+ * session resumption.
+ */
+class ZNetworkContext : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ZNetworkContext(QObject *parent = nullptr);
+    ~ZNetworkContext();
+
+    static ZNetworkContext *instance();
+
+    QNetworkAccessManager *manager() const { return m_manager; }
+    QNetworkAccessManager *transferManager() const
+    {
+        return m_transferManager;
+    }
+    QThread *transferThread() const { return m_transferThread; }
+
+    static void prepareRequest(QNetworkRequest &request);
+
+public slots:
+    void prewarm(const QUrl &url);
+
+private:
+    void prewarmInTransferThread(const QUrl &url);
+    void connectToHost(const QUrl &url);
+
+    QNetworkAccessManager *m_manager;
+    QNetworkAccessManager *m_transferManager;
+    QThread *m_transferThread;
+};
+
+#endif
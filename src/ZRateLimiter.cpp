@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZRateLimiter.h"
+#include <QDebug>
+#include <QtMath>
+#include <limits>
+
+/* Size of the bucket, the longest burst allowed after an idle period */
+static const qint64 BURST_MS = 250;
+static const qint64 MIN_BURST = 16 * 1024;
+
+/* Adaptive mode: start rate, lowest rate and additive increase */
+static const qint64 ADAPTIVE_START_RATE = 512 * 1024;
+static const qint64 ADAPTIVE_MIN_RATE = 32 * 1024;
+static const qint64 ADAPTIVE_STEP = 64 * 1024;
+
+/* Queueing delay we tolerate before backing off */
+static const qint64 TARGET_DELAY_MS = 100;
+
+ZRateLimiter::ZRateLimiter()
+    : m_rate(0), m_adaptive(false), m_adaptiveRate(ADAPTIVE_START_RATE),
+      m_baseRtt(-1), m_tokens(0), m_lastRefill(0)
+{
+}
+
+/**
+ * Limits the download to \a bytesPerSecond, 0 removes the limit. In adaptive
+ * mode this is the highest rate the limiter may reach.
+ */
+void ZRateLimiter::setRate(qint64 bytesPerSecond)
+{
+    m_rate = qMax<qint64>(bytesPerSecond, 0);
+}
+
+void ZRateLimiter::setAdaptive(bool adaptive) { m_adaptive = adaptive; }
+
+/**
+ * Returns the rate the bucket is refilled at, 0 if the download is not
+ * limited
+ */
+qint64 ZRateLimiter::currentRate() const
+{
+    if (!m_adaptive)
+        return m_rate;
+
+    return m_rate > 0 ? qMin(m_adaptiveRate, m_rate) : m_adaptiveRate;
+}
+
+/**
+ * Returns the read buffer size that keeps the reply from reading much more
+ * than the bucket holds, capped at \a maximum
+ */
+qint64 ZRateLimiter::bufferSize(qint64 maximum) const
+{
+    if (!isLimited())
+        return maximum;
+
+    qint64 size = qMax(currentRate() * BURST_MS / 1000, MIN_BURST);
+    return maximum > 0 ? qMin(size, maximum) : size;
+}
+
+/**
+ * Resets the bucket and, in adaptive mode, what was learned about the link
+ */
+void ZRateLimiter::start()
+{
+    /* Start low, below the ceiling, and let the round trips drive it up */
+    m_adaptiveRate = ADAPTIVE_START_RATE;
+    if (m_rate > 0)
+        m_adaptiveRate = qMax(qMin(m_rate / 2, m_adaptiveRate),
+                              ADAPTIVE_MIN_RATE);
+    m_baseRtt = -1;
+
+    m_tokens = qreal(bufferSize(0));
+    m_clock.start();
+    m_lastRefill = 0;
+}
+
+/**
+ * Returns the number of bytes that may be read right now
+ */
+qint64 ZRateLimiter::available()
+{
+    if (!isLimited())
+        return std::numeric_limits<qint64>::max();
+
+    refill();
+    return qMax<qint64>(qint64(m_tokens), 0);
+}
+
+void ZRateLimiter::consume(qint64 bytes)
+{
+    if (isLimited())
+        m_tokens -= bytes;
+}
+
+/**
+ * Returns how many milliseconds it takes until \a bytes may be read
+ */
+int ZRateLimiter::delayFor(qint64 bytes) const
+{
+    qint64 rate = currentRate();
+    if (rate <= 0)
+        return 0;
+
+    /* Never wait for more than a full bucket */
+    qreal missing = qMin<qreal>(bytes, bufferSize(0)) - m_tokens;
+    if (missing <= 0)
+        return 0;
+
+    return qMax(1, qCeil(missing * 1000 / rate));
+}
+
+/**
+ * Feeds the round trip time measured while the download is running into the
+ * adaptive rate
+ */
+void ZRateLimiter::addRttSample(qint64 msecs)
+{
+    if (!m_adaptive || msecs < 0)
+        return;
+
+    if (m_baseRtt < 0 || msecs < m_baseRtt)
+        m_baseRtt = msecs;
+
+    qint64 previous = m_adaptiveRate;
+    if (msecs - m_baseRtt > TARGET_DELAY_MS) {
+        m_adaptiveRate = qMax(m_adaptiveRate * 7 / 10, ADAPTIVE_MIN_RATE);
+    } else {
+        m_adaptiveRate += ADAPTIVE_STEP;
+        if (m_rate > 0)
+            m_adaptiveRate = qMin(m_adaptiveRate, m_rate);
+    }
+
+    if (m_adaptiveRate != previous)
+        qDebug() << "ZRateLimiter: rtt" << msecs << "ms, base" << m_baseRtt
+                 << "ms, rate" << m_adaptiveRate / 1024 << "KiB/s";
+}
+
+void ZRateLimiter::refill()
+{
+    qint64 now = m_clock.nsecsElapsed();
+    qreal elapsed = qreal(now - m_lastRefill) / 1e9;
+    m_lastRefill = now;
+
+    m_tokens = qMin(m_tokens + elapsed * currentRate(), qreal(bufferSize(0)));
+}
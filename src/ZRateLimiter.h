@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZRATE_LIMITER_H
+#define ZRATE_LIMITER_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+/**
+ * Token bucket that paces a download.
+ *
+ * Tokens (bytes) accumulate at the current rate, up to a quarter of a second
+ * worth of them. The transfer only reads as much from the network as there
+ * are tokens, and keeps the reply read buffer about as small as the bucket,
+ * so Qt stops reading from the socket and TCP flow control slows the sender
+ * down instead of the data piling up in memory.
+ *
+ * In adaptive (background) mode the rate is not fixed. It follows the round
+ * trip times reported with addRttSample(): it grows slowly while they stay
+ * close to the lowest one seen, and backs off quickly when they rise, i.e.
+ * when the download starts filling the queues of the link and delaying
+ * everyone else's traffic. The fixed rate, if any, remains the ceiling.
+ */
+class ZRateLimiter
+{
+public:
+    ZRateLimiter();
+
+    qint64 rate() const { return m_rate; }
+    void setRate(qint64 bytesPerSecond);
+    bool isAdaptive() const { return m_adaptive; }
+    void setAdaptive(bool adaptive);
+    bool isLimited() const { return m_rate > 0 || m_adaptive; }
+
+    qint64 currentRate() const;
+    qint64 bufferSize(qint64 maximum) const;
+
+    void start();
+    qint64 available();
+    void consume(qint64 bytes);
+    int delayFor(qint64 bytes) const;
+
+    void addRttSample(qint64 msecs);
+
+private:
+    void refill();
+
+    qint64 m_rate;
+    bool m_adaptive;
+    qint64 m_adaptiveRate;
+    qint64 m_baseRtt;
+
+    qreal m_tokens;
+    QElapsedTimer m_clock;
+    qint64 m_lastRefill;
+};
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZReleaseCache.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QStringList>
+
+ZReleaseCache::ZReleaseCache(const QString &repoOwnerSlashName,
+                             const QString &currentVersion,
+                             bool skipPrerelease)
+    : m_repoOwnerSlashName(repoOwnerSlashName),
+      m_currentVersion(currentVersion), m_skipPrerelease(skipPrerelease),
+      m_valid(false), m_checkedAt(0)
+{
+    QString dir =
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (dir.isEmpty())
+        dir = QDir::tempPath();
+
+    setCacheDir(QDir(dir).filePath("zupdater"));
+}
+
+/**
+ * Changes the directory the cache file is stored in
+ */
+void ZReleaseCache::setCacheDir(const QString &dir)
+{
+    QString name = m_repoOwnerSlashName;
+    name.replace('/', '_');
+    m_filePath = QDir(dir).filePath(name + ".json");
+}
+
+/**
+ * Reads the cache file. Returns false if there is no usable entry for this
+ * repository and application version.
+ */
+bool ZReleaseCache::load()
+{
+    m_valid = false;
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+    if (obj.value("repo").toString() != m_repoOwnerSlashName ||
+        obj.value("current_version").toString() != m_currentVersion ||
+        obj.value("skip_prerelease").toBool() != m_skipPrerelease)
+        return false;
+
+    m_checkedAt = obj.value("checked_at").toInteger();
+    m_etag = obj.value("etag").toString().toUtf8();
+    m_lastModified = obj.value("last_modified").toString().toUtf8();
+    m_release = obj.value("release").toObject();
+    m_valid = true;
+    return true;
+}
+
+/**
+ * Stores the current entry, marking it as checked right now
+ */
+bool ZReleaseCache::save()
+{
+    m_checkedAt = QDateTime::currentSecsSinceEpoch();
+    m_valid = true;
+
+    QJsonObject obj;
+    obj.insert("repo", m_repoOwnerSlashName);
+    obj.insert("current_version", m_currentVersion);
+    obj.insert("skip_prerelease", m_skipPrerelease);
+    obj.insert("checked_at", m_checkedAt);
+    obj.insert("etag", QString::fromUtf8(m_etag));
+    obj.insert("last_modified", QString::fromUtf8(m_lastModified));
+    obj.insert("release", m_release);
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    return file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact)) > 0;
+}
+
+/**
+ * Returns true if the entry was checked less than \a ttlSeconds ago, in which
+ * case there is no need to ask the server at all
+ */
+bool ZReleaseCache::isFresh(int ttlSeconds) const
+{
+    if (!m_valid || ttlSeconds <= 0)
+        return false;
+
+    qint64 age = QDateTime::currentSecsSinceEpoch() - m_checkedAt;
+    return age >= 0 && age < ttlSeconds;
+}
+
+/**
+ * Makes \a request conditional, so that the server answers with
+ * 304 Not Modified if the releases did not change
+ */
+void ZReleaseCache::applyValidators(QNetworkRequest &request) const
+{
+    if (!m_valid)
+        return;
+
+    if (!m_etag.isEmpty())
+        request.setRawHeader("If-None-Match", m_etag);
+    if (!m_lastModified.isEmpty())
+        request.setRawHeader("If-Modified-Since", m_lastModified);
+}
+
+void ZReleaseCache::updateValidators(const QNetworkReply *reply)
+{
+    m_etag = reply->rawHeader("ETag");
+    m_lastModified = reply->rawHeader("Last-Modified");
+}
+
+/**
+ * Stores \a release, keeping only the fields the updater needs
+ */
+void ZReleaseCache::setRelease(const QJsonObject &release)
+{
+    m_release = QJsonObject();
+    if (release.isEmpty())
+        return;
+
+    const QStringList releaseKeys = {"tag_name", "prerelease", "body",
+                                     "html_url"};
+    for (const QString &key : releaseKeys)
+        m_release.insert(key, release.value(key));
+
+    const QStringList assetKeys = {"name", "browser_download_url", "size",
+                                   "digest"};
+
+    QJsonArray assets;
+    const QJsonArray releaseAssets = release.value("assets").toArray();
+    for (const QJsonValue &a : releaseAssets) {
+        QJsonObject asset = a.toObject();
+        QJsonObject reduced;
+        for (const QString &key : assetKeys)
+            reduced.insert(key, asset.value(key));
+        assets.append(reduced);
+    }
+
+    m_release.insert("assets", assets);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZRELEASE_CACHE_H
+#define ZRELEASE_CACHE_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+class QNetworkReply;
+class QNetworkRequest;
+
+/**
+ * On-disk cache of the last release check of a repository.
+ *
+ * Stores the validators (ETag/Last-Modified) of the last releases response
+ * together with the release that was selected from it, so that an unchanged
+ * list can be answered with 304 Not Modified and never parsed again. The
+ * cached result is only valid for the application version (and prerelease
+ * setting) that produced it.
+ */
+class ZReleaseCache
+{
+public:
+    ZReleaseCache(const QString &repoOwnerSlashName,
+                  const QString &currentVersion, bool skipPrerelease);
+
+    QString filePath() const { return m_filePath; }
+    void setCacheDir(const QString &dir);
+
+    bool load();
+    bool save();
+
+    bool isValid() const { return m_valid; }
+    bool isFresh(int ttlSeconds) const;
+
+    void applyValidators(QNetworkRequest &request) const;
+    void updateValidators(const QNetworkReply *reply);
+
+    QJsonObject release() const { return m_release; }
+    void setRelease(const QJsonObject &release);
+
+private:
+    QString m_repoOwnerSlashName;
+    QString m_currentVersion;
+    bool m_skipPrerelease;
+    QString m_filePath;
+
+    bool m_valid;
+    qint64 m_checkedAt;
+    QByteArray m_etag;
+    QByteArray m_lastModified;
+    QJsonObject m_release;
+};
+
+#endif
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZReleaseParser.h"
+#include <cstring>
+
+/* Nothing in a release comes close to this, anything deeper is garbage */
+static const int MAX_DEPTH = 64;
+
+/* Keys we extract, indexed by ZReleaseParser::Field */
+static const char *const FIELD_NAMES[] = {
+    "",       "tag_name", "prerelease", "body", "html_url",
+    "assets", "name", "browser_download_url", "size", "digest"};
+
+static bool keyEquals(const char *data, qint64 size, const char *key)
+{
+    return qint64(strlen(key)) == size && memcmp(data, key, size_t(size)) == 0;
+}
+
+ZReleaseParser::ZReleaseParser() { reset(); }
+
+/**
+ * Discards all state so that a new document can be parsed
+ */
+void ZReleaseParser::reset()
+{
+    m_buffer.clear();
+    m_pos = 0;
+    m_scopes.clear();
+    m_expectKey = false;
+    m_done = false;
+    m_field = None;
+    m_error.clear();
+    m_release = QJsonObject();
+    m_assets = QJsonArray();
+    m_asset = QJsonObject();
+    m_releases.clear();
+    m_releaseCount = 0;
+}
+
+/**
+ * Parses the next chunk of the document. Data that ends in the middle of a
+ * token is kept until the rest of it arrives.
+ *
+ * Returns false if the document is malformed.
+ */
+bool ZReleaseParser::feed(const QByteArray &data)
+{
+    if (m_done || hasError())
+        return !hasError();
+
+    m_buffer.append(data);
+    bool ok = parse();
+
+    /* Keep only the incomplete token, if any */
+    m_buffer.remove(0, m_pos);
+    m_pos = 0;
+    return ok;
+}
+
+bool ZReleaseParser::parse()
+{
+    while (m_pos < m_buffer.size() && !m_done) {
+        char c = m_buffer.at(m_pos);
+        switch (c) {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            ++m_pos;
+            break;
+        case ',':
+            m_expectKey = inObject();
+            ++m_pos;
+            break;
+        case ':':
+            m_expectKey = false;
+            ++m_pos;
+            break;
+        case '{':
+        case '[':
+            if (!openScope(c == '{'))
+                return false;
+            ++m_pos;
+            break;
+        case '}':
+        case ']':
+            if (!closeScope(c == '}'))
+                return false;
+            ++m_pos;
+            break;
+        case '"': {
+            qint64 end = findStringEnd(m_pos + 1);
+            if (end < 0)
+                return true;
+            if (!string(m_pos + 1, end))
+                return false;
+            m_pos = end + 1;
+            break;
+        }
+        default: {
+            qint64 end = m_pos;
+            while (end < m_buffer.size() &&
+                   !strchr(",}] \t\r\n", m_buffer.at(end)))
+                ++end;
+            if (end == m_buffer.size())
+                return true;
+            if (!literal(m_pos, end))
+                return false;
+            m_pos = end;
+            break;
+        }
+        }
+    }
+
+    return true;
+}
+
+bool ZReleaseParser::inObject() const
+{
+    if (m_scopes.isEmpty())
+        return false;
+
+    Scope scope = m_scopes.last();
+    return scope == Release || scope == Asset || scope == SkipObject;
+}
+
+bool ZReleaseParser::openScope(bool object)
+{
+    if (m_scopes.size() >= MAX_DEPTH)
+        return setError(QStringLiteral("Document nested too deeply"));
+
+    Scope skip = object ? SkipObject : SkipArray;
+    Scope scope = skip;
+    if (m_scopes.isEmpty()) {
+        scope = object ? Release : TopArray;
+    } else {
+        switch (m_scopes.last()) {
+        case TopArray:
+            scope = object ? Release : skip;
+            break;
+        case Release:
+            scope = (!object && m_field == AssetList) ? Assets : skip;
+            break;
+        case Assets:
+            scope = object ? Asset : skip;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (scope == Release) {
+        m_release = QJsonObject();
+        m_assets = QJsonArray();
+    } else if (scope == Asset) {
+        m_asset = QJsonObject();
+    }
+
+    m_scopes.append(scope);
+    m_expectKey = object;
+    m_field = None;
+    return true;
+}
+
+bool ZReleaseParser::closeScope(bool object)
+{
+    if (m_scopes.isEmpty() || inObject() != object)
+        return setError(QStringLiteral("Unbalanced brackets"));
+
+    Scope scope = m_scopes.last();
+    m_scopes.removeLast();
+
+    if (scope == Asset) {
+        m_assets.append(m_asset);
+    } else if (scope == Release) {
+        m_release.insert(QStringLiteral("assets"), m_assets);
+        m_releases.append(m_release);
+        ++m_releaseCount;
+    }
+
+    m_expectKey = false;
+    m_field = None;
+    m_done = m_scopes.isEmpty();
+    return true;
+}
+
+/**
+ * Handles the string between \a begin and \a end. Keys of releases and assets
+ * are matched in place, values are only decoded if we are interested in them.
+ */
+bool ZReleaseParser::string(qint64 begin, qint64 end)
+{
+    if (m_scopes.isEmpty())
+        return setError(QStringLiteral("Expected an array or an object"));
+
+    Scope scope = m_scopes.last();
+    const char *data = m_buffer.constData() + begin;
+    qint64 size = end - begin;
+
+    if (m_expectKey) {
+        m_field = None;
+        int first = (scope == Release) ? TagName : Name;
+        int last = (scope == Release) ? AssetList : Digest;
+        if (scope == Release || scope == Asset) {
+            for (int f = first; f <= last; ++f) {
+                if (keyEquals(data, size, FIELD_NAMES[f])) {
+                    m_field = Field(f);
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    switch (m_field) {
+    case TagName:
+    case Body:
+    case HtmlUrl:
+        if (scope == Release)
+            m_release.insert(QLatin1String(FIELD_NAMES[m_field]),
+                             decodeString(begin, end));
+        break;
+    case Name:
+    case DownloadUrl:
+    case Digest:
+        if (scope == Asset)
+            m_asset.insert(QLatin1String(FIELD_NAMES[m_field]),
+                           decodeString(begin, end));
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+/**
+ * Handles numbers, booleans and null
+ */
+bool ZReleaseParser::literal(qint64 begin, qint64 end)
+{
+    if (m_scopes.isEmpty())
+        return setError(QStringLiteral("Expected an array or an object"));
+
+    const char *data = m_buffer.constData() + begin;
+    qint64 size = end - begin;
+    char c = data[0];
+    if (c != 't' && c != 'f' && c != 'n' && c != '-' && (c < '0' || c > '9'))
+        return setError(QStringLiteral("Unexpected character at offset %1")
+                            .arg(begin));
+
+    Scope scope = m_scopes.last();
+    if (scope == Release && m_field == Prerelease) {
+        m_release.insert(QStringLiteral("prerelease"),
+                         keyEquals(data, size, "true"));
+    } else if (scope == Asset && m_field == Size) {
+        m_asset.insert(QStringLiteral("size"),
+                       QByteArray::fromRawData(data, size).toLongLong());
+    }
+
+    return true;
+}
+
+/**
+ * Returns the position of the quote that ends the string starting at \a pos,
+ * or -1 if it has not been received yet
+ */
+qint64 ZReleaseParser::findStringEnd(qint64 pos) const
+{
+    const char *data = m_buffer.constData();
+    qint64 size = m_buffer.size();
+    qint64 start = pos;
+
+    while (pos < size) {
+        const char *quote =
+            static_cast<const char *>(memchr(data + pos, '"', size_t(size - pos)));
+        if (!quote)
+            return -1;
+
+        /* An odd number of backslashes escapes the quote */
+        qint64 i = quote - data;
+        qint64 b = i;
+        while (b > start && data[b - 1] == '\\')
+            --b;
+        if ((i - b) % 2 == 0)
+            return i;
+
+        pos = i + 1;
+    }
+
+    return -1;
+}
+
+QString ZReleaseParser::decodeString(qint64 begin, qint64 end) const
+{
+    const char *data = m_buffer.constData() + begin;
+    qint64 size = end - begin;
+
+    if (!memchr(data, '\\', size_t(size)))
+        return QString::fromUtf8(data, size);
+
+    QString result;
+    result.reserve(size);
+
+    qint64 run = 0;
+    for (qint64 i = 0; i < size; ++i) {
+        if (data[i] != '\\')
+            continue;
+
+        result += QString::fromUtf8(data + run, i - run);
+
+        /* The closing quote is never escaped, so this stays in bounds */
+        char e = data[++i];
+        switch (e) {
+        case 'b':
+            result += QLatin1Char('\b');
+            break;
+        case 'f':
+            result += QLatin1Char('\f');
+            break;
+        case 'n':
+            result += QLatin1Char('\n');
+            break;
+        case 'r':
+            result += QLatin1Char('\r');
+            break;
+        case 't':
+            result += QLatin1Char('\t');
+            break;
+        case 'u':
+            /* Surrogate pairs arrive as two escapes and combine by
+             * themselves */
+            if (i + 4 < size) {
+                bool ok = false;
+                ushort code =
+                    QByteArray::fromRawData(data + i + 1, 4).toUShort(&ok, 16);
+                if (ok)
+                    result += QChar(code);
+                i += 4;
+            }
+            break;
+        default:
+            result += QLatin1Char(e);
+            break;
+        }
+
+        run = i + 1;
+    }
+
+    result += QString::fromUtf8(data + run, size - run);
+    return result;
+}
+
+bool ZReleaseParser::setError(const QString &error)
+{
+    m_error = error;
+    return false;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZRELEASE_PARSER_H
+#define ZRELEASE_PARSER_H
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QVarLengthArray>
+
+/**
+ * Incremental parser for the GitHub release list.
+ *
+ * Data can be fed in arbitrary chunks as it arrives from the network. Only
+ * the fields the updater needs are decoded (tag_name, prerelease, body,
+ * html_url and the name, browser_download_url, size and digest of each
+ * asset), everything else is skipped without being materialized. Each
+ * release becomes available through takeRelease() as soon as its closing
+ * brace has been read, so the caller can stop reading once it has seen
+ * enough.
+ *
+ * Both a release array and a single release object (as returned by
+ * /releases/latest) are accepted.
+ */
+class ZReleaseParser
+{
+public:
+    ZReleaseParser();
+
+    void reset();
+    bool feed(const QByteArray &data);
+
+    bool hasRelease() const { return !m_releases.isEmpty(); }
+    QJsonObject takeRelease() { return m_releases.takeFirst(); }
+
+    int releaseCount() const { return m_releaseCount; }
+    bool atEnd() const { return m_done; }
+    bool hasError() const { return !m_error.isEmpty(); }
+    QString errorString() const { return m_error; }
+
+private:
+    enum Scope { TopArray, Release, Assets, Asset, SkipObject, SkipArray };
+    enum Field {
+        None,
+        TagName,
+        Prerelease,
+        Body,
+        HtmlUrl,
+        AssetList,
+        Name,
+        DownloadUrl,
+        Size,
+        Digest
+    };
+
+    bool parse();
+    bool inObject() const;
+    bool openScope(bool object);
+    bool closeScope(bool object);
+    bool string(qint64 begin, qint64 end);
+    bool literal(qint64 begin, qint64 end);
+    qint64 findStringEnd(qint64 pos) const;
+    QString decodeString(qint64 begin, qint64 end) const;
+    bool setError(const QString &error);
+
+    QByteArray m_buffer;
+    qint64 m_pos;
+
+    QVarLengthArray<Scope, 8> m_scopes;
+    bool m_expectKey;
+    bool m_done;
+    Field m_field;
+    QString m_error;
+
+    QJsonObject m_release;
+    QJsonArray m_assets;
+    QJsonObject m_asset;
+    QList<QJsonObject> m_releases;
+    int m_releaseCount;
+};
+
+#endif
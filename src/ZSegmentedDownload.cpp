@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZSegmentedDownload.h"
+#include "ZFileSink.h"
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <utility>
+
+/* A segment that received nothing for this long is restarted */
+static const int STALL_TIMEOUT_MS = 8000;
+static const int MAX_SEGMENT_RETRIES = 3;
+
+/* The probe only wants one byte, a server that sends more is cut off */
+static const qint64 PROBE_READ_BUFFER = 4096;
+
+/* Smallest share of the read buffer a connection gets */
+static const qint64 MIN_SEGMENT_READ_BUFFER = 64 * 1024;
+
+/* Do not split ranges into pieces smaller than this */
+static const qint64 MIN_STEAL_SIZE = 256 * 1024;
+
+ZSegmentedDownload::ZSegmentedDownload(QNetworkAccessManager *manager,
+                                       QObject *parent)
+    : QObject(parent), m_manager(manager), m_probe(nullptr),
+      m_segmentCount(4), m_readBufferSize(DefaultReadBufferSize),
+      m_running(false), m_total(0), m_received(0),
+      m_stallTimer(this)
+{
+    m_buffer.resize(256 * 1024);
+
+    m_stallTimer.setInterval(1000);
+    connect(&m_stallTimer, &QTimer::timeout, this,
+            &ZSegmentedDownload::checkStalls);
+}
+
+ZSegmentedDownload::~ZSegmentedDownload() { abort(); }
+
+/**
+ * Changes the number of concurrent connections used for the next download
+ */
+void ZSegmentedDownload::setSegmentCount(int count)
+{
+    m_segmentCount = qBound(1, count, 16);
+}
+
+/**
+ * Bounds the data the connections buffer in memory to about \a size bytes
+ * in total, 0 for no limit. Each connection gets an equal share, Qt stops
+ * reading from its socket once the share is full.
+ */
+void ZSegmentedDownload::setReadBufferSize(qint64 size)
+{
+    m_readBufferSize = qMax<qint64>(size, 0);
+}
+
+/**
+ * Downloads the resource described by \a request into \a filePath.
+ *
+ * If the server does not support range requests, rangesUnsupported() is
+ * emitted and nothing is written, so the caller can fall back to a regular
+ * single-stream download.
+ */
+void ZSegmentedDownload::start(const QNetworkRequest &request,
+                               const QString &filePath)
+{
+    abort();
+
+    m_request = request;
+    m_running = true;
+    m_total = 0;
+    m_received = 0;
+    m_file.setFileName(filePath);
+    m_clock.start();
+
+    /* Ask for a single byte, the answer tells us the size of the file and
+     * whether ranges are supported. It also resolves any redirect once
+     * instead of once per segment. */
+    QNetworkRequest probe(request);
+    probe.setRawHeader("Range", "bytes=0-0");
+
+    m_probe = m_manager->get(probe);
+    m_probe->setReadBufferSize(PROBE_READ_BUFFER);
+    connect(m_probe, &QNetworkReply::metaDataChanged, this,
+            &ZSegmentedDownload::probeMetaDataChanged);
+    connect(m_probe, &QNetworkReply::finished, this,
+            &ZSegmentedDownload::probeFinished);
+}
+
+/**
+ * Cancels the download, the (partial) file is left on disk
+ */
+void ZSegmentedDownload::abort()
+{
+    if (!m_running)
+        return;
+
+    m_running = false;
+    clear();
+}
+
+/**
+ * Gives up on the probe as soon as its headers show that the range was
+ * ignored, instead of receiving the whole file only to download it again
+ */
+void ZSegmentedDownload::probeMetaDataChanged()
+{
+    int status = m_probe->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    /* Redirects are followed, only the final response counts */
+    if (status >= 300 && status < 400)
+        return;
+
+    if (status != 206 ||
+        !m_probe->rawHeader("Content-Range").startsWith("bytes 0-0/")) {
+        qDebug() << "ZSegmentedDownload: server ignored range request";
+        rejectRanges();
+    }
+}
+
+void ZSegmentedDownload::probeFinished()
+{
+    QNetworkReply *probe = m_probe;
+    m_probe = nullptr;
+    probe->deleteLater();
+
+    /* Content-Range: bytes 0-0/<total> */
+    int status = probe->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QByteArray range = probe->rawHeader("Content-Range");
+    qint64 total = range.mid(range.lastIndexOf('/') + 1).toLongLong();
+
+    if (probe->error() != QNetworkReply::NoError || status != 206 ||
+        !range.startsWith("bytes 0-0/") || total <= 0) {
+        rejectRanges();
+        return;
+    }
+
+    m_url = probe->url();
+    m_total = total;
+
+    /* Preallocate the file so every segment can write at its offset */
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fail(m_file.errorString());
+        return;
+    }
+
+    QString error;
+    if (!ZFileSink::preallocate(m_file, m_total, &error)) {
+        fail(error);
+        return;
+    }
+
+    if (!m_file.resize(m_total)) {
+        fail(m_file.errorString());
+        return;
+    }
+
+    /* Small files do not benefit from many connections */
+    int count = int(qBound<qint64>(1, m_total / MinSegmentSize, m_segmentCount));
+    qint64 size = m_total / count;
+
+    for (int i = 0; i < count; ++i) {
+        Segment *segment = new Segment;
+        segment->pos = i * size;
+        segment->end = (i == count - 1) ? m_total : (i + 1) * size;
+        segment->retries = 0;
+        segment->reply = nullptr;
+        m_segments.append(segment);
+        startSegment(segment);
+    }
+
+    qDebug() << "ZSegmentedDownload:" << m_total << "bytes in" << count
+             << "segments from" << m_url.host();
+
+    m_stallTimer.start();
+    emit downloadProgress(0, m_total);
+}
+
+/**
+ * Requests the remaining bytes of \a segment
+ */
+void ZSegmentedDownload::startSegment(Segment *segment)
+{
+    QNetworkRequest request(m_request);
+    request.setUrl(m_url);
+    request.setRawHeader("Range", "bytes=" + QByteArray::number(segment->pos) +
+                                      "-" +
+                                      QByteArray::number(segment->end - 1));
+
+    segment->lastActivity = m_clock.elapsed();
+    segment->reply = m_manager->get(request);
+    if (m_readBufferSize > 0)
+        segment->reply->setReadBufferSize(qMax(
+            MIN_SEGMENT_READ_BUFFER, m_readBufferSize / m_segmentCount));
+    connect(segment->reply, &QNetworkReply::readyRead, this,
+            [this, segment]() { readSegment(segment); });
+    connect(segment->reply, &QNetworkReply::finished, this,
+            [this, segment]() { segmentFinished(segment); });
+}
+
+/**
+ * Writes the data received for \a segment at its offset in the file
+ */
+void ZSegmentedDownload::readSegment(Segment *segment)
+{
+    QNetworkReply *reply = segment->reply;
+    if (!reply)
+        return;
+
+    /* A server that ignores the range would overwrite other segments */
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 206) {
+        fail(tr("Server ignored range request"));
+        return;
+    }
+
+    segment->lastActivity = m_clock.elapsed();
+    qint64 before = segment->pos;
+
+    /* The end of the segment may have moved since the request was sent */
+    while (segment->pos < segment->end) {
+        qint64 wanted = qMin<qint64>(m_buffer.size(), segment->end - segment->pos);
+        qint64 read = reply->read(m_buffer.data(), wanted);
+        if (read <= 0)
+            break;
+
+        if (!m_file.seek(segment->pos) ||
+            m_file.write(m_buffer.constData(), read) != read) {
+            fail(m_file.errorString());
+            return;
+        }
+
+        segment->pos += read;
+        m_received += read;
+    }
+
+    /* Only count attempts that did not make any progress */
+    if (segment->pos > before)
+        segment->retries = 0;
+
+    emit downloadProgress(m_received, m_total);
+
+    if (segment->pos >= segment->end) {
+        releaseReply(segment);
+        continueWith(segment);
+    }
+}
+
+void ZSegmentedDownload::segmentFinished(Segment *segment)
+{
+    QNetworkReply *reply = segment->reply;
+    if (!reply || !m_running)
+        return;
+
+    if (reply->error() == QNetworkReply::NoError)
+        readSegment(segment);
+
+    /* readSegment() may have completed the segment or failed everything */
+    if (!m_running || !segment->reply)
+        return;
+
+    QString error = reply->errorString();
+    releaseReply(segment);
+
+    /* Connection dropped before the range was complete */
+    if (segment->pos < segment->end) {
+        if (++segment->retries > MAX_SEGMENT_RETRIES) {
+            fail(error);
+            return;
+        }
+
+        startSegment(segment);
+        return;
+    }
+
+    continueWith(segment);
+}
+
+/**
+ * Restarts the connections that have not received anything for a while. The
+ * idle connections left behind by faster segments will take over half of
+ * their work as soon as they are free.
+ */
+void ZSegmentedDownload::checkStalls()
+{
+    qint64 now = m_clock.elapsed();
+    for (Segment *segment : std::as_const(m_segments)) {
+        if (!segment->reply || now - segment->lastActivity < STALL_TIMEOUT_MS)
+            continue;
+
+        qDebug() << "ZSegmentedDownload: segment at" << segment->pos
+                 << "stalled, restarting";
+
+        releaseReply(segment);
+        if (++segment->retries > MAX_SEGMENT_RETRIES) {
+            fail(tr("Download stalled"));
+            return;
+        }
+
+        startSegment(segment);
+    }
+}
+
+void ZSegmentedDownload::releaseReply(Segment *segment)
+{
+    QNetworkReply *reply = segment->reply;
+    if (!reply)
+        return;
+
+    segment->reply = nullptr;
+    reply->disconnect(this);
+    if (!reply->isFinished())
+        reply->abort();
+    reply->deleteLater();
+}
+
+/**
+ * Called when the connection used by \a segment has nothing left to do. The
+ * connection steals the second half of the largest pending range, or the
+ * download completes if there is no work left at all.
+ */
+void ZSegmentedDownload::continueWith(Segment *segment)
+{
+    Q_UNUSED(segment);
+
+    Segment *victim = nullptr;
+    bool busy = false;
+    for (Segment *s : std::as_const(m_segments)) {
+        if (s->pos >= s->end)
+            continue;
+
+        busy = true;
+        if (s->reply &&
+            (!victim || s->end - s->pos > victim->end - victim->pos))
+            victim = s;
+    }
+
+    if (victim && victim->end - victim->pos >= 2 * MIN_STEAL_SIZE) {
+        qint64 middle = victim->pos + (victim->end - victim->pos) / 2;
+
+        Segment *stolen = new Segment;
+        stolen->pos = middle;
+        stolen->end = victim->end;
+        stolen->retries = 0;
+        stolen->reply = nullptr;
+        victim->end = middle;
+
+        m_segments.append(stolen);
+        startSegment(stolen);
+        return;
+    }
+
+    if (busy)
+        return;
+
+    /* Every byte is on disk */
+    m_running = false;
+    m_file.close();
+    clear();
+    emit finished();
+}
+
+/**
+ * Stops the download and lets the caller fall back to a single stream
+ */
+void ZSegmentedDownload::rejectRanges()
+{
+    m_running = false;
+    clear();
+    emit rangesUnsupported();
+}
+
+void ZSegmentedDownload::fail(const QString &error)
+{
+    if (!m_running)
+        return;
+
+    qWarning() << "ZSegmentedDownload:" << error;
+    m_running = false;
+    clear();
+    emit failed(error);
+}
+
+void ZSegmentedDownload::clear()
+{
+    m_stallTimer.stop();
+
+    if (m_probe) {
+        m_probe->disconnect(this);
+        m_probe->abort();
+        m_probe->deleteLater();
+        m_probe = nullptr;
+    }
+
+    for (Segment *segment : std::as_const(m_segments))
+        releaseReply(segment);
+
+    qDeleteAll(m_segments);
+    m_segments.clear();
+    m_file.close();
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZSEGMENTED_DOWNLOAD_H
+#define ZSEGMENTED_DOWNLOAD_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+
+class QNetworkReply;
+class QNetworkAccessManager;
+
+/**
+ * Downloads a file over several HTTP connections at once.
+ *
+ * The size of the file is obtained with a one byte range request, the target
+ * file is preallocated and split into byte ranges that are fetched
+ * concurrently and written at their offsets. Whenever a connection runs out
+ * of work it takes over half of the largest range that is still pending, so
+ * slow or stalled connections do not hold up the whole transfer.
+ */
+class ZSegmentedDownload : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void downloadProgress(qint64 received, qint64 total);
+    void finished();
+    void failed(const QString &error);
+    void rangesUnsupported();
+
+public:
+    static constexpr qint64 MinSegmentSize = 1024 * 1024;
+    static constexpr qint64 DefaultReadBufferSize = 1024 * 1024;
+
+    explicit ZSegmentedDownload(QNetworkAccessManager *manager,
+                                QObject *parent = nullptr);
+    ~ZSegmentedDownload();
+
+    int segmentCount() const { return m_segmentCount; }
+    void setSegmentCount(int count);
+    qint64 readBufferSize() const { return m_readBufferSize; }
+    void setReadBufferSize(qint64 size);
+    bool isRunning() const { return m_running; }
+
+public slots:
+    void start(const QNetworkRequest &request, const QString &filePath);
+    void abort();
+
+private slots:
+    void probeMetaDataChanged();
+    void probeFinished();
+    void checkStalls();
+
+private:
+    struct Segment {
+        qint64 pos;
+        qint64 end;
+        int retries;
+        qint64 lastActivity;
+        QNetworkReply *reply;
+    };
+
+    void startSegment(Segment *segment);
+    void readSegment(Segment *segment);
+    void segmentFinished(Segment *segment);
+    void releaseReply(Segment *segment);
+    void continueWith(Segment *segment);
+    void rejectRanges();
+    void fail(const QString &error);
+    void clear();
+
+    QNetworkAccessManager *m_manager;
+    QNetworkRequest m_request;
+    QNetworkReply *m_probe;
+    QUrl m_url;
+
+    QFile m_file;
+    QByteArray m_buffer;
+    QList<Segment *> m_segments;
+
+    int m_segmentCount;
+    qint64 m_readBufferSize;
+    bool m_running;
+    qint64 m_total;
+    qint64 m_received;
+
+    QTimer m_stallTimer;
+    QElapsedTimer m_clock;
+};
+
+#endif
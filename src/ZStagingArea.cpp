@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZStagingArea.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QStandardPaths>
+
+static const QString MANIFEST("staged.json");
+
+/**
+ * Returns the SHA-256 of \a filePath in lowercase hex, or an empty string if
+ * it can't be read
+ */
+static QString sha256Of(const QString &filePath)
+{
+    QFile file(filePath);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file))
+        return QString();
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+ZStagingArea::ZStagingArea(const QString &repoOwnerSlashName)
+    : m_repoOwnerSlashName(repoOwnerSlashName),
+      m_sizeLimit(DefaultSizeLimit)
+{
+    /* Unlike the release cache, this has to survive cache cleanups */
+    QString dir =
+        QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    if (dir.isEmpty())
+        dir = QDir::tempPath();
+
+    setDir(QDir(dir).filePath("zupdater/staging"));
+}
+
+/**
+ * Changes the directory updates are staged in, each repository gets its own
+ * subdirectory
+ */
+void ZStagingArea::setDir(const QString &dir)
+{
+    QString name = m_repoOwnerSlashName;
+    name.replace('/', '_');
+    m_dir = QDir(dir).filePath(name);
+}
+
+/**
+ * Returns true if the asset of \a downloadProfile is within the size limit.
+ * Assets of unknown size are staged.
+ */
+bool ZStagingArea::fits(const QVariantMap &downloadProfile) const
+{
+    qint64 size = downloadProfile.value("size").toLongLong();
+    return m_sizeLimit <= 0 || size <= m_sizeLimit;
+}
+
+QString ZStagingArea::directoryFor(const QVariantMap &downloadProfile) const
+{
+    /* Tags may contain anything, keep the directory name portable */
+    static const QRegularExpression unsafe("[^A-Za-z0-9._+-]");
+    QString tag = downloadProfile.value("tag_name").toString();
+    tag.replace(unsafe, "_");
+    return QDir(m_dir).filePath(tag);
+}
+
+/**
+ * Returns the path of the staged asset of \a downloadProfile, or an empty
+ * string if it hasn't been (completely) staged. The manifest must describe
+ * the same asset, a release whose asset was replaced is downloaded again,
+ * and the file must still have the SHA-256 recorded when it was staged.
+ */
+QString ZStagingArea::stagedFile(const QVariantMap &downloadProfile) const
+{
+    QDir dir(directoryFor(downloadProfile));
+    QFile file(dir.filePath(MANIFEST));
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+
+    QJsonObject manifest = QJsonDocument::fromJson(file.readAll()).object();
+    QString path = dir.filePath(manifest.value("file").toString());
+    QString staged = manifest.value("sha256").toString();
+    QString sha256 = downloadProfile.value("sha256").toString().toLower();
+    qint64 size = downloadProfile.value("size").toLongLong();
+
+    /* Without a recorded hash there is nothing to check the file against */
+    if (manifest.value("url").toString() !=
+            downloadProfile.value("browser_download_url").toString() ||
+        staged.isEmpty() || (!sha256.isEmpty() && staged != sha256) ||
+        (size > 0 && manifest.value("size").toInteger() != size) ||
+        QFileInfo(path).size() != manifest.value("size").toInteger())
+        return QString();
+
+    if (sha256Of(path) != staged) {
+        qWarning() << "ZStagingArea: staged file changed, discarding" << path;
+        return QString();
+    }
+
+    return path;
+}
+
+/**
+ * Records the verified download \a filePath as the staged asset of
+ * \a downloadProfile, along with its SHA-256. Returns false if the file
+ * doesn't match the hash of the profile.
+ */
+bool ZStagingArea::add(const QVariantMap &downloadProfile,
+                       const QString &filePath)
+{
+    QFileInfo info(filePath);
+    QDir dir(directoryFor(downloadProfile));
+    if (info.absoluteDir() != dir)
+        return false;
+
+    /* The profile may only have a checksums file, record what was verified */
+    QString sha256 = sha256Of(filePath);
+    QString expected = downloadProfile.value("sha256").toString().toLower();
+    if (sha256.isEmpty() || (!expected.isEmpty() && sha256 != expected))
+        return false;
+
+    QJsonObject manifest;
+    manifest.insert("tag_name", downloadProfile.value("tag_name").toString());
+    manifest.insert("url",
+                    downloadProfile.value("browser_download_url").toString());
+    manifest.insert("sha256", sha256);
+    manifest.insert("file", info.fileName());
+    manifest.insert("size", info.size());
+    manifest.insert("staged_at", QDateTime::currentSecsSinceEpoch());
+
+    QFile file(dir.filePath(MANIFEST));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    return file.write(QJsonDocument(manifest).toJson(
+               QJsonDocument::Compact)) > 0;
+}
+
+/**
+ * Removes every staged update except the one of the release \a keepTag,
+ * complete or not
+ */
+void ZStagingArea::evict(const QString &keepTag)
+{
+    QString keep;
+    if (!keepTag.isEmpty())
+        keep = QFileInfo(directoryFor({{"tag_name", keepTag}})).fileName();
+
+    QDir dir(m_dir);
+    const QStringList entries =
+        dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries) {
+        if (entry == keep)
+            continue;
+
+        qDebug() << "ZStagingArea: evicting" << entry;
+        QDir(dir.filePath(entry)).removeRecursively();
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZSTAGING_AREA_H
+#define ZSTAGING_AREA_H
+
+#include <QString>
+#include <QVariantMap>
+
+/**
+ * Directory where updates are downloaded ahead of time.
+ *
+ * Every release gets its own subdirectory, named after its tag. A manifest
+ * is written next to the asset once it has been downloaded and verified, so
+ * a staged update survives restarts and a half-finished one is never
+ * mistaken for a complete one (the transfer resumes it instead). The
+ * manifest records the SHA-256 of the verified asset, and the staged copy is
+ * hashed again before it is reused, so a file that changed on disk since is
+ * downloaded again.
+ *
+ * Only one update is kept: staging a release evicts every other one, and so
+ * does a check that finds the application up to date. The size limit keeps
+ * large assets from being downloaded behind the user's back.
+ */
+class ZStagingArea
+{
+public:
+    static constexpr qint64 DefaultSizeLimit = 1024 * 1024 * 1024;
+
+    explicit ZStagingArea(const QString &repoOwnerSlashName);
+
+    QString dir() const { return m_dir; }
+    void setDir(const QString &dir);
+
+    qint64 sizeLimit() const { return m_sizeLimit; }
+    void setSizeLimit(qint64 bytes) { m_sizeLimit = bytes; }
+    bool fits(const QVariantMap &downloadProfile) const;
+
+    QString directoryFor(const QVariantMap &downloadProfile) const;
+    QString stagedFile(const QVariantMap &downloadProfile) const;
+    bool add(const QVariantMap &downloadProfile, const QString &filePath);
+    void evict(const QString &keepTag = QString());
+
+private:
+    QString m_repoOwnerSlashName;
+    QString m_dir;
+    qint64 m_sizeLimit;
+};
+
+#endif
@@ -0,0 +1,1078 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZTransfer.h"
+#include "ZBlockUpdate.h"
+#include "ZContentDecoder.h"
+#include "ZDeltaDownload.h"
+#include "ZNetworkContext.h"
+#include "ZSegmentedDownload.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QTimer>
+
+static const QString PARTIAL_DOWN(".part");
+static const QString RESUME_INFO(".resume");
+
+/* Consecutive failed attempts (without new data) before we give up */
+static const int MAX_RETRIES = 3;
+
+/* How often the resume offset is brought up to date while data arrives */
+static const int RESUME_INFO_INTERVAL_MS = 1000;
+
+/* How often the round trip time is measured in background mode */
+static const int PROBE_INTERVAL_MS = 2000;
+
+/**
+ * Returns true if the transfer failed because of the connection rather than
+ * because of the request itself, i.e. if it makes sense to resume it.
+ */
+static bool isTransientError(QNetworkReply::NetworkError error)
+{
+    switch (error) {
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::OperationCanceledError: /* transfer timeout */
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::ServiceUnavailableError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+ZTransfer::ZTransfer(QNetworkAccessManager *manager, QObject *parent)
+    : QObject(parent), m_manager(manager), m_reply(nullptr),
+      m_readBufferSize(DefaultReadBufferSize),
+      m_compression(ZContentDecoder::Identity), m_decodeTime(0), m_cpuStart(0),
+      m_metricsEnabled(false), m_retries(0), m_cancelled(false),
+      m_resumeOffset(0), m_checksumReply(nullptr),
+      m_throttleTimer(this), m_probeTimer(this), m_probeReply(nullptr),
+      m_segmentCount(1), m_rangesUnsupported(false),
+      m_blockUpdateFailed(false), m_deltaFailed(false)
+{
+    qRegisterMetaType<ZMetrics>();
+
+    /* Without a shared manager, use a private one */
+    if (!m_manager)
+        m_manager = new QNetworkAccessManager(this);
+
+    m_segmented = new ZSegmentedDownload(m_manager, this);
+    connect(m_segmented, SIGNAL(downloadProgress(qint64, qint64)), this,
+            SLOT(segmentedProgress(qint64, qint64)));
+    connect(m_segmented, SIGNAL(finished()), this, SLOT(segmentedFinished()));
+    connect(m_segmented, SIGNAL(failed(QString)), this,
+            SLOT(segmentedFailed(QString)));
+    connect(m_segmented, SIGNAL(rangesUnsupported()), this,
+            SLOT(rangesUnsupported()));
+
+    m_blockUpdate = new ZBlockUpdate(m_manager, this);
+    connect(m_blockUpdate, SIGNAL(downloadProgress(qint64, qint64)), this,
+            SLOT(segmentedProgress(qint64, qint64)));
+    connect(m_blockUpdate, SIGNAL(finished()), this,
+            SLOT(blockUpdateFinished()));
+    connect(m_blockUpdate, SIGNAL(failed(QString)), this,
+            SLOT(blockUpdateFailed(QString)));
+
+    m_delta = new ZDeltaDownload(m_manager, this);
+    connect(m_delta, SIGNAL(downloadProgress(qint64, qint64)), this,
+            SLOT(segmentedProgress(qint64, qint64)));
+    connect(m_delta, SIGNAL(finished()), this, SLOT(deltaFinished()));
+    connect(m_delta, SIGNAL(failed(QString)), this,
+            SLOT(deltaFailed(QString)));
+
+    m_throttleTimer.setSingleShot(true);
+    connect(&m_throttleTimer, SIGNAL(timeout()), this, SLOT(saveFile()));
+
+    m_probeTimer.setInterval(PROBE_INTERVAL_MS);
+    connect(&m_probeTimer, SIGNAL(timeout()), this, SLOT(probeLatency()));
+}
+
+ZTransfer::~ZTransfer() { m_sink.close(); }
+
+void ZTransfer::setDownloadDir(const QString &downloadDir)
+{
+    m_downloadDir.setPath(downloadDir);
+}
+
+void ZTransfer::setFileName(const QString &file) { m_fileName = file; }
+
+void ZTransfer::setUserAgentString(const QString &agent)
+{
+    m_userAgentString = agent;
+}
+
+void ZTransfer::setReadBufferSize(qint64 size)
+{
+    m_readBufferSize = qMax<qint64>(size, 0);
+    if (m_reply)
+        m_reply->setReadBufferSize(m_limiter.bufferSize(m_readBufferSize));
+}
+
+void ZTransfer::setSegmentCount(int count)
+{
+    m_segmentCount = qBound(1, count, 16);
+}
+
+void ZTransfer::setExpectedHash(const QByteArray &sha256)
+{
+    m_expectedHash = sha256.trimmed().toLower();
+}
+
+void ZTransfer::setChecksumsUrl(const QUrl &url) { m_checksumsUrl = url; }
+
+/**
+ * Enables differential updates: the blocks listed in the index at \a url
+ * that can be found in \a seedFile (the installed version) are copied from
+ * it instead of being downloaded. The other blocks are fetched from
+ * \a fileUrl, the download URL by default. A compressed download (see
+ * setCompression()) needs \a fileUrl to point at the plain file, otherwise
+ * the block update is skipped.
+ */
+void ZTransfer::setBlockIndex(const QUrl &url, const QString &seedFile,
+                              const QUrl &fileUrl)
+{
+    m_blockIndexUrl = url;
+    m_blockFileUrl = fileUrl;
+    m_seedFile = seedFile;
+    m_blockUpdateFailed = false;
+}
+
+/**
+ * Prefers the patch at \a url, which turns \a baseFile (the installed
+ * version) into the requested file, over downloading the whole file
+ */
+void ZTransfer::setDelta(const QUrl &url, const QString &baseFile)
+{
+    m_deltaUrl = url;
+    m_baseFile = baseFile;
+    m_deltaFailed = false;
+}
+
+/**
+ * Limits the download to \a bytesPerSecond (0 for no limit). In
+ * \a background mode the rate also backs off whenever the download makes the
+ * round trip times of the link grow, and the limit is only the ceiling. A
+ * running download follows the new limit right away.
+ */
+void ZTransfer::setRateLimit(qint64 bytesPerSecond, bool background)
+{
+    bool changed = m_limiter.rate() != qMax<qint64>(bytesPerSecond, 0) ||
+                   m_limiter.isAdaptive() != background;
+
+    m_limiter.setRate(bytesPerSecond);
+    m_limiter.setAdaptive(background);
+    if (!m_reply || !changed)
+        return;
+
+    /* Resize the read buffer too, it is what turns the limit into TCP
+     * backpressure */
+    m_limiter.start();
+    m_reply->setReadBufferSize(m_limiter.bufferSize(m_readBufferSize));
+    if (!m_limiter.isAdaptive())
+        m_probeTimer.stop();
+    else if (!m_probeTimer.isActive())
+        m_probeTimer.start();
+
+    /* Data held back for the old rate may be due sooner now */
+    if (m_reply->bytesAvailable() > 0)
+        m_throttleTimer.start(m_limiter.delayFor(m_reply->bytesAvailable()));
+}
+
+/**
+ * Collects a ZMetrics breakdown of the transfers started from now on
+ */
+void ZTransfer::setMetricsEnabled(bool enabled) { m_metricsEnabled = enabled; }
+
+/**
+ * Changes how the file is written to disk, see ZWriteStrategy
+ */
+void ZTransfer::setWriteStrategy(const ZWriteStrategy &strategy)
+{
+    m_writeStrategy = strategy;
+}
+
+/**
+ * Declares that the file at the URL is compressed with \a encoding (zstd or
+ * xz). It is decompressed while it downloads and saved under the file name
+ * without the extension, the expected hash is the one of the decompressed
+ * file.
+ */
+void ZTransfer::setCompression(ZContentDecoder::Encoding encoding)
+{
+    m_compression = encoding;
+}
+
+/**
+ * Begins downloading the file at the given \a url
+ */
+void ZTransfer::start(const QUrl &url)
+{
+    /* Configure the network request */
+    QNetworkRequest request(url);
+    ZNetworkContext::prepareRequest(request);
+
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                         QNetworkRequest::NoLessSafeRedirectPolicy);
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    request.setTransferTimeout(StallTimeout);
+#endif
+
+    if (!m_userAgentString.isEmpty())
+        request.setRawHeader("User-Agent", m_userAgentString.toUtf8());
+
+    /* Ensure that downloads directory exists */
+    if (!m_downloadDir.exists())
+        m_downloadDir.mkpath(".");
+
+    /* Forget about the previous attempt */
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->deleteLater();
+        m_reply = nullptr;
+    }
+
+    m_throttleTimer.stop();
+    m_probeTimer.stop();
+
+    /* Remove old downloads, but keep a partial download we can resume */
+    m_sink.close();
+    m_url = url;
+    m_cancelled = false;
+    QFile::remove(m_downloadDir.filePath(m_fileName));
+
+    /* The decoder state can't be restored, compressed files start over */
+    if (m_compression == ZContentDecoder::Identity) {
+        m_resumeOffset = prepareResume(request);
+    } else {
+        m_resumeOffset = 0;
+        QFile::remove(partFilePath() + RESUME_INFO);
+    }
+
+    m_cpuStart = std::clock();
+    m_progressTimer.invalidate();
+    m_startClock.start();
+    m_firstByteTime = -1;
+
+    /* Retries, redirects and fallbacks add to the metrics of the first
+     * attempt */
+    if (m_metricsEnabled && !m_metrics.clock.isValid()) {
+        m_metrics = ZMetrics("download", url);
+        m_metrics.clock.start();
+    }
+
+    /* Fetch the published checksums while the file downloads */
+    if (m_expectedHash.isEmpty() && m_checksumsUrl.isValid() &&
+        !m_checksumReply) {
+        QNetworkRequest sums(m_checksumsUrl);
+        ZNetworkContext::prepareRequest(sums);
+        sums.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                          QNetworkRequest::NoLessSafeRedirectPolicy);
+        if (!m_userAgentString.isEmpty())
+            sums.setRawHeader("User-Agent", m_userAgentString.toUtf8());
+        ZContentDecoder::negotiate(sums);
+
+        m_checksumName = m_fileName;
+        m_checksumReply = m_manager->get(sums);
+        connect(m_checksumReply, SIGNAL(finished()), this,
+                SLOT(checksumsFinished()));
+    }
+
+    /* A patch against the installed version is the smallest download */
+    if (m_deltaUrl.isValid() && !m_deltaFailed && m_resumeOffset == 0 &&
+        ZDeltaDownload::isSupported() && QFileInfo::exists(m_baseFile)) {
+        QNetworkRequest patch(request);
+        patch.setUrl(m_deltaUrl);
+        m_delta->start(patch, m_baseFile, partFilePath());
+        return;
+    }
+
+    /* Rebuild the file from the installed version when possible, only the
+     * blocks that changed are downloaded. The block offsets are those of the
+     * plain file, so they can't be fetched from a compressed one. */
+    bool blockSource = m_blockFileUrl.isValid() ||
+                       m_compression == ZContentDecoder::Identity;
+    if (m_blockIndexUrl.isValid() && !m_blockUpdateFailed && blockSource &&
+        m_resumeOffset == 0 && QFileInfo::exists(m_seedFile)) {
+        QNetworkRequest blocks(request);
+        if (m_blockFileUrl.isValid())
+            blocks.setUrl(m_blockFileUrl);
+        m_blockUpdate->start(blocks, m_blockIndexUrl, m_seedFile,
+                             partFilePath());
+        return;
+    }
+
+    /* Fetch large files over several connections, unless we are resuming
+     * a single-stream download or already know the server can't do it.
+     * A rate limited download gains nothing from more connections. */
+    if (m_segmentCount > 1 && m_resumeOffset == 0 && !m_rangesUnsupported &&
+        !m_limiter.isLimited() && m_compression == ZContentDecoder::Identity) {
+        m_segmented->setSegmentCount(m_segmentCount);
+        m_segmented->setReadBufferSize(m_readBufferSize);
+        m_segmented->start(request, partFilePath());
+        return;
+    }
+
+    /* Keep the partial file open for the whole transfer */
+    m_sink.setHashing(verificationEnabled());
+    m_sink.setBufferSize(m_writeStrategy.bufferSize);
+    if (!m_sink.open(partFilePath(), m_resumeOffset)) {
+        qWarning() << "ZTransfer: cannot open" << m_sink.fileName() << ":"
+                   << m_sink.errorString();
+        reportMetrics(false, m_sink.errorString());
+        emit failed(m_sink.errorString());
+        return;
+    }
+
+    m_decoder.reset();
+    m_decodeTime = 0;
+    if (m_compression != ZContentDecoder::Identity &&
+        !m_decoder.start(m_compression)) {
+        m_sink.close();
+        QFile::remove(m_sink.fileName());
+        reportMetrics(false, m_decoder.errorString());
+        emit failed(m_decoder.errorString());
+        return;
+    }
+
+    /* Start download */
+    m_reply = m_manager->get(request);
+    if (m_metrics.clock.isValid())
+        m_metrics.track(m_reply, this);
+
+    /* Bound the memory held by the reply, the sink drains it as it fills.
+     * When rate limited, the buffer is kept close to the size of the token
+     * bucket so the limit turns into TCP backpressure. */
+    m_limiter.start();
+    m_reply->setReadBufferSize(m_limiter.bufferSize(m_readBufferSize));
+    if (m_limiter.isAdaptive())
+        m_probeTimer.start();
+
+    connect(m_reply, SIGNAL(metaDataChanged()), this, SLOT(metaDataChanged()));
+    connect(m_reply, SIGNAL(readyRead()), this, SLOT(saveFile()));
+    connect(m_reply, SIGNAL(downloadProgress(qint64, qint64)), this,
+            SLOT(replyProgress(qint64, qint64)));
+    connect(m_reply, SIGNAL(finished()), this, SLOT(finishedReply()));
+}
+
+/**
+ * Cancels the download and removes the partial file
+ */
+void ZTransfer::abort()
+{
+    m_cancelled = true;
+    m_metrics.clock.invalidate();
+
+    if (m_segmented->isRunning()) {
+        m_segmented->abort();
+        QFile::remove(partFilePath());
+    }
+
+    if (m_blockUpdate->isRunning()) {
+        m_blockUpdate->abort();
+        QFile::remove(partFilePath());
+    }
+
+    if (m_delta->isRunning()) {
+        m_delta->abort();
+        QFile::remove(partFilePath());
+    }
+
+    m_throttleTimer.stop();
+    m_probeTimer.stop();
+    if (m_probeReply)
+        m_probeReply->abort();
+
+    if (m_reply && !m_reply->isFinished())
+        m_reply->abort();
+}
+
+void ZTransfer::finishedReply()
+{
+    m_throttleTimer.stop();
+    m_probeTimer.stop();
+
+    if (m_reply->error() != QNetworkReply::NoError) {
+        bool resumable = !m_cancelled && isTransientError(m_reply->error());
+
+        /* Keep what we got so far if we are going to resume */
+        if (resumable)
+            writeReply();
+        m_sink.close();
+        addSinkTimes();
+
+        if (!resumable) {
+            QFile::remove(m_sink.fileName());
+            QFile::remove(m_sink.fileName() + RESUME_INFO);
+            if (!m_cancelled) {
+                reportMetrics(false, m_reply->errorString());
+                emit failed(m_reply->errorString());
+            }
+            return;
+        }
+
+        saveResumeInfo();
+
+        /* Only count attempts that did not make any progress */
+        if (m_sink.bytesWritten() > 0)
+            m_retries = 0;
+
+        if (m_retries < MAX_RETRIES) {
+            ++m_retries;
+            qDebug() << "ZTransfer:" << m_reply->errorString()
+                     << "- resuming at" << m_resumeOffset + m_sink.bytesWritten()
+                     << "bytes, attempt" << m_retries;
+
+            QUrl url = m_url;
+            emit retrying(m_retries);
+            QTimer::singleShot(RetryDelay * m_retries, this, [this, url]() {
+                if (!m_cancelled)
+                    start(url);
+            });
+        } else {
+            reportMetrics(false, tr("Download interrupted"));
+            emit failed(tr("Download interrupted"));
+        }
+
+        return;
+    }
+
+    /* Write whatever is still buffered and release the file, the tail is
+     * already in memory so it isn't held back by the rate limit */
+    writeReply();
+    bool decoded = finishDecoding();
+    m_sink.close();
+    addSinkTimes();
+
+    if (!decoded) {
+        QString error = tr("Cannot decompress the download: %1")
+                            .arg(m_decoder.errorString());
+        qWarning() << "ZTransfer:" << error;
+        QFile::remove(m_sink.fileName());
+        QFile::remove(m_sink.fileName() + RESUME_INFO);
+        reportMetrics(false, error);
+        emit failed(error);
+        return;
+    }
+
+    m_retries = 0;
+    QFile::remove(m_sink.fileName() + RESUME_INFO);
+    reportStats();
+
+    m_reply->close();
+    m_downloadHash = m_sink.hash();
+    completeDownload(m_sink.fileName());
+}
+
+/**
+ * Verifies and renames the finished \a partFile, then notifies the receiver
+ */
+void ZTransfer::completeDownload(const QString &partFile)
+{
+    /* We can't verify the file until we know its checksum */
+    if (m_checksumReply) {
+        m_completedPart = partFile;
+        return;
+    }
+
+    QString error;
+    if (!verifyDownload(partFile, &error)) {
+        reportMetrics(false, error);
+        emit failed(error);
+        return;
+    }
+
+    /* Rename file (the name may have changed after the download started) */
+    if (!ZFileSink::commit(partFile, m_downloadDir.filePath(m_fileName),
+                           m_writeStrategy.sync, &error)) {
+        qWarning() << "ZTransfer: cannot save" << m_fileName << ":" << error;
+        reportMetrics(false, error);
+        emit failed(error);
+        return;
+    }
+
+    reportMetrics(true);
+    emit finished(m_url, m_downloadDir.filePath(m_fileName));
+}
+
+void ZTransfer::segmentedFinished()
+{
+    qDebug() << "ZTransfer: segmented download finished in"
+             << qreal(std::clock() - m_cpuStart) / CLOCKS_PER_SEC << "s CPU";
+
+    /* Segments arrive out of order, so the hash can't be computed while
+     * streaming. Read the file back instead, it is likely still cached. */
+    if (verificationEnabled()) {
+        QElapsedTimer timer;
+        timer.start();
+
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        QFile file(partFilePath());
+        if (file.open(QIODevice::ReadOnly))
+            hash.addData(&file);
+        m_downloadHash = hash.result();
+
+        if (m_metrics.clock.isValid())
+            m_metrics.hashTime = qMax<qint64>(m_metrics.hashTime, 0) +
+                                 timer.nsecsElapsed();
+    }
+
+    completeDownload(partFilePath());
+}
+
+void ZTransfer::segmentedFailed(const QString &error)
+{
+    QFile::remove(partFilePath());
+    if (!m_cancelled) {
+        reportMetrics(false, error);
+        emit failed(error);
+    }
+}
+
+/**
+ * The server can't serve byte ranges, download over a single connection
+ */
+void ZTransfer::rangesUnsupported()
+{
+    m_rangesUnsupported = true;
+    start(m_url);
+}
+
+void ZTransfer::blockUpdateFinished()
+{
+    qDebug() << "ZTransfer: block update finished in"
+             << qreal(std::clock() - m_cpuStart) / CLOCKS_PER_SEC << "s CPU";
+
+    if (verificationEnabled())
+        m_downloadHash = m_blockUpdate->sha256();
+
+    completeDownload(partFilePath());
+}
+
+void ZTransfer::blockUpdateFailed(const QString &error)
+{
+    QFile::remove(partFilePath());
+    if (m_cancelled)
+        return;
+
+    /* Whatever went wrong, the regular download still works */
+    qDebug() << "ZTransfer: block update failed (" << error
+             << "), downloading the whole file";
+    m_blockUpdateFailed = true;
+    start(m_url);
+}
+
+void ZTransfer::deltaFinished()
+{
+    qDebug() << "ZTransfer: patch applied in"
+             << qreal(std::clock() - m_cpuStart) / CLOCKS_PER_SEC << "s CPU";
+
+    /* The patched file is checked against the hash of the full asset */
+    if (verificationEnabled())
+        m_downloadHash = m_delta->sha256();
+
+    completeDownload(partFilePath());
+}
+
+void ZTransfer::deltaFailed(const QString &error)
+{
+    QFile::remove(partFilePath());
+    if (m_cancelled)
+        return;
+
+    qDebug() << "ZTransfer: delta update failed (" << error
+             << "), falling back";
+    m_deltaFailed = true;
+    start(m_url);
+}
+
+/**
+ * Looks up the checksum of our file in the downloaded SHA256SUMS list and
+ * finishes the download if it was waiting for it.
+ */
+void ZTransfer::checksumsFinished()
+{
+    QNetworkReply *reply = m_checksumReply;
+    m_checksumReply = nullptr;
+    reply->deleteLater();
+
+    /* Lines look like "<sha256>  <file name>" (or "<sha256> *<file name>"),
+     * single-file .sha256 assets may only contain the hash */
+    QByteArray body;
+    QString error;
+    if (!ZContentDecoder::readReply(reply, &body, &error))
+        qWarning() << "ZTransfer: cannot decode the checksums:" << error;
+
+    const QList<QByteArray> lines = body.split('\n');
+    for (const QByteArray &line : lines) {
+        QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.first().size() != 64)
+            continue;
+
+        QByteArray name = fields.size() > 1 ? fields.at(1) : QByteArray();
+        if (name.startsWith('*'))
+            name.remove(0, 1);
+
+        if (name.isEmpty() || name == m_checksumName.toUtf8()) {
+            m_expectedHash = fields.first().toLower();
+            if (!name.isEmpty())
+                break;
+        }
+    }
+
+    if (reply->error() != QNetworkReply::NoError || m_expectedHash.isEmpty())
+        qWarning() << "ZTransfer: no checksum found for" << m_checksumName
+                   << "in" << m_checksumsUrl;
+
+    if (!m_completedPart.isEmpty()) {
+        QString partFile = m_completedPart;
+        m_completedPart.clear();
+        completeDownload(partFile);
+    }
+}
+
+bool ZTransfer::verificationEnabled() const
+{
+    return !m_expectedHash.isEmpty() || m_checksumsUrl.isValid();
+}
+
+/**
+ * Compares the hash of the downloaded data with the published one. Corrupted
+ * downloads are removed, and so are downloads that were meant to be checked
+ * against a checksums file we couldn't get a hash from.
+ */
+bool ZTransfer::verifyDownload(const QString &partFile, QString *error)
+{
+    if (m_expectedHash.isEmpty() && !m_checksumsUrl.isValid()) {
+        qDebug() << "ZTransfer: no checksum published, skipping verification";
+        return true;
+    }
+
+    if (m_expectedHash.isEmpty()) {
+        qWarning() << "ZTransfer: cannot verify" << partFile
+                   << "without a checksum";
+        *error = tr("The checksum of the downloaded file is not available");
+    } else if (m_downloadHash.toHex() == m_expectedHash) {
+        qDebug() << "ZTransfer: SHA-256 verified";
+        return true;
+    } else {
+        qWarning() << "ZTransfer: SHA-256 mismatch, expected"
+                   << m_expectedHash << "got" << m_downloadHash.toHex();
+        *error = tr("The downloaded file is corrupted");
+    }
+
+    QFile::remove(partFile);
+    QFile::remove(partFile + RESUME_INFO);
+    return false;
+}
+
+/**
+ * Writes the downloaded data to the disk
+ */
+void ZTransfer::saveFile()
+{
+    /* Check if we need to redirect */
+    QUrl url =
+        m_reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+    if (!url.isEmpty()) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        start(url);
+        return;
+    }
+
+    /* Stream downloaded data to disk through the sink buffer. The read
+     * buffer is bounded, so draining it all here is cheap and lets Qt
+     * resume reading from the socket. When rate limited, only take what
+     * the token bucket allows and come back once it has refilled. */
+    qint64 allowed = m_limiter.available();
+    qint64 written = writeReply(allowed);
+    if (written < 0 && m_decoder.hasError()) {
+        discardReply(tr("Cannot decompress the download: %1")
+                         .arg(m_decoder.errorString()));
+        return;
+    }
+    if (written < 0) {
+        qWarning() << "ZTransfer: write failed:" << m_sink.errorString();
+        m_reply->abort();
+        return;
+    }
+
+    m_limiter.consume(written);
+    if (m_reply->bytesAvailable() > 0 && !m_throttleTimer.isActive())
+        m_throttleTimer.start(m_limiter.delayFor(m_reply->bytesAvailable()));
+
+    /* Keep the resume offset close to what has been flushed, so that a
+     * crash only loses the last moments of the download */
+    if (m_compression == ZContentDecoder::Identity &&
+        m_resumeInfoClock.isValid() &&
+        m_resumeInfoClock.elapsed() >= RESUME_INFO_INTERVAL_MS)
+        saveResumeInfo();
+}
+
+/**
+ * Measures the round trip time with a HEAD request to the server we are
+ * downloading from. It queues behind our own data on a congested link, so
+ * the adaptive rate can tell when the download starts to hurt other users.
+ */
+void ZTransfer::probeLatency()
+{
+    if (m_probeReply || !m_reply)
+        return;
+
+    /* Skip the redirects, any response will do */
+    QNetworkRequest request(m_reply->url());
+    ZNetworkContext::prepareRequest(request);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                         QNetworkRequest::ManualRedirectPolicy);
+    if (!m_userAgentString.isEmpty())
+        request.setRawHeader("User-Agent", m_userAgentString.toUtf8());
+
+    m_probeClock.start();
+    m_probeReply = m_manager->head(request);
+    connect(m_probeReply, SIGNAL(finished()), this, SLOT(probeFinished()));
+}
+
+void ZTransfer::probeFinished()
+{
+    QNetworkReply *reply = m_probeReply;
+    m_probeReply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() == QNetworkReply::OperationCanceledError ||
+        !m_reply || m_reply->isFinished())
+        return;
+
+    /* Only the timing matters, error responses count as well */
+    m_limiter.addRttSample(m_probeClock.elapsed());
+    m_reply->setReadBufferSize(m_limiter.bufferSize(m_readBufferSize));
+}
+
+/**
+ * Logs the time it took from start() to the first response from the server,
+ * which includes the connection setup unless a warm connection was reused
+ */
+void ZTransfer::noteFirstByte()
+{
+    if (m_firstByteTime >= 0)
+        return;
+
+    m_firstByteTime = m_startClock.elapsed();
+    qDebug() << "ZTransfer: time to first byte" << m_firstByteTime << "ms";
+}
+
+/**
+ * Moves the data available in the reply (at most \a maxSize bytes unless it
+ * is negative) to the sink, through the decoder if the file is compressed.
+ * Returns the number of bytes taken from the reply, or -1 on error.
+ */
+qint64 ZTransfer::writeReply(qint64 maxSize)
+{
+    if (m_compression == ZContentDecoder::Identity)
+        return m_sink.write(m_reply, maxSize);
+
+    QByteArray data = maxSize < 0 ? m_reply->readAll() : m_reply->read(maxSize);
+
+    /* The output buffer keeps its capacity from one chunk to the next */
+    QElapsedTimer timer;
+    timer.start();
+    m_decoded.resize(0);
+    bool ok = m_decoder.decode(data, &m_decoded);
+    m_decodeTime += timer.nsecsElapsed();
+
+    if (!ok || !m_sink.write(m_decoded.constData(), m_decoded.size()))
+        return -1;
+
+    return data.size();
+}
+
+/**
+ * Writes out what the decoder still holds once the whole file has arrived,
+ * and logs how well it was compressed. Fails if the file is incomplete.
+ */
+bool ZTransfer::finishDecoding()
+{
+    if (m_compression == ZContentDecoder::Identity)
+        return true;
+
+    QElapsedTimer timer;
+    timer.start();
+    m_decoded.resize(0);
+    bool ok = m_decoder.finish(&m_decoded) &&
+              m_sink.write(m_decoded.constData(), m_decoded.size());
+    m_decodeTime += timer.nsecsElapsed();
+
+    qint64 in = m_decoder.bytesIn();
+    qint64 out = m_decoder.bytesOut();
+    qDebug() << "ZTransfer:" << ZContentDecoder::name(m_compression)
+             << "decompressed" << in << "to" << out << "bytes, ratio"
+             << (in > 0 ? qreal(out) / in : 0) << "at"
+             << (m_decodeTime > 0 ? out * 1e3 / m_decodeTime : 0) << "MB/s";
+
+    if (m_metrics.clock.isValid()) {
+        m_metrics.encoding = QString::fromLatin1(
+            ZContentDecoder::name(m_compression));
+        m_metrics.wireBytes = in;
+        m_metrics.bytes = out;
+        m_metrics.decodeTime = m_decodeTime;
+    }
+
+    return ok;
+}
+
+/**
+ * Logs how much work it took to write the download to disk
+ */
+void ZTransfer::reportStats()
+{
+    qreal mb = qMax<qreal>(m_sink.bytesWritten() / 1048576.0, 1.0 / 1048576);
+    qreal cpu = qreal(std::clock() - m_cpuStart) / CLOCKS_PER_SEC;
+
+    /* One open() and one close() plus the buffered writes */
+    qint64 syscalls = m_sink.writeCalls() + 2;
+
+    qDebug() << "ZTransfer:" << m_sink.bytesWritten() << "bytes written,"
+             << cpu << "s CPU," << syscalls / mb << "file syscalls/MB,"
+             << cpu / mb << "s CPU/MB";
+}
+
+/**
+ * Gives up on the current reply because of a local problem, there is no
+ * point in retrying
+ */
+void ZTransfer::discardReply(const QString &error)
+{
+    qWarning() << "ZTransfer:" << error;
+
+    m_throttleTimer.stop();
+    m_probeTimer.stop();
+    m_reply->disconnect(this);
+    m_reply->abort();
+
+    m_sink.close();
+    QFile::remove(m_sink.fileName());
+    QFile::remove(m_sink.fileName() + RESUME_INFO);
+
+    reportMetrics(false, error);
+    emit failed(error);
+}
+
+/**
+ * Emits the metrics of the transfer, if they are being collected
+ */
+void ZTransfer::reportMetrics(bool ok, const QString &error)
+{
+    if (!m_metrics.clock.isValid())
+        return;
+
+    m_metrics.finish(ok, error);
+    emit metrics(m_metrics);
+}
+
+/**
+ * Adds the time the sink spent writing and hashing the current attempt to
+ * the metrics
+ */
+void ZTransfer::addSinkTimes()
+{
+    if (!m_metrics.clock.isValid())
+        return;
+
+    m_metrics.writeTime = qMax<qint64>(m_metrics.writeTime, 0) +
+                          m_sink.writeTime();
+    m_metrics.hashTime = qMax<qint64>(m_metrics.hashTime, 0) +
+                         m_sink.hashTime();
+}
+
+/**
+ * Get response filename and check whether the server honored our range
+ * request.
+ */
+void ZTransfer::metaDataChanged()
+{
+    noteFirstByte();
+
+    int status =
+        m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (status == 200 || status == 206) {
+        /* Content-Range must start exactly where our partial file ends */
+        QByteArray range = m_reply->rawHeader("Content-Range");
+        QByteArray expected = "bytes " + QByteArray::number(m_resumeOffset) + "-";
+        bool resumed = status == 206 && range.startsWith(expected);
+
+        if (m_resumeOffset > 0 && !resumed) {
+            qDebug() << "ZTransfer: server ignored range request, restarting"
+                     << "from scratch";
+            m_resumeOffset = 0;
+            if (!m_sink.open(m_sink.fileName())) {
+                discardReply(m_sink.errorString());
+                return;
+            }
+        }
+
+        m_etag = m_reply->rawHeader("ETag");
+        m_lastModified = m_reply->rawHeader("Last-Modified");
+        saveResumeInfo();
+
+        /* Claim the disk space now rather than fail halfway through. The
+         * size of a compressed file on disk isn't known up front. */
+        qint64 length =
+            m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        if (m_compression == ZContentDecoder::Identity &&
+            m_writeStrategy.preallocate && length > 0 &&
+            !m_sink.reserve(m_resumeOffset + length)) {
+            discardReply(m_sink.errorString());
+            return;
+        }
+    }
+
+    QString filename = "";
+    QVariant variant =
+        m_reply->header(QNetworkRequest::ContentDispositionHeader);
+    if (variant.isValid()) {
+        QString contentDisposition =
+            QByteArray::fromPercentEncoding(variant.toByteArray()).constData();
+        QRegularExpression regExp(R"(filename=(\S+))");
+        QRegularExpressionMatch match = regExp.match(contentDisposition);
+        if (match.hasMatch()) {
+            filename = match.captured(1);
+        }
+        /* A compressed file is saved decompressed */
+        QString baseName;
+        if (m_compression != ZContentDecoder::Identity &&
+            ZContentDecoder::fileEncoding(filename, &baseName) == m_compression)
+            filename = baseName;
+        setFileName(filename.isEmpty() ? QString("ZUpdate.bin") : filename);
+    }
+}
+
+void ZTransfer::replyProgress(qint64 received, qint64 total)
+{
+    /* Account for the data we already had when resuming */
+    reportProgress(m_resumeOffset + received,
+                   total > 0 ? m_resumeOffset + total : total,
+                   received == total);
+}
+
+void ZTransfer::segmentedProgress(qint64 received, qint64 total)
+{
+    noteFirstByte();
+    reportProgress(received, total, received == total);
+}
+
+/**
+ * Forwards the progress to the user interface thread, but no more often than
+ * every ProgressInterval milliseconds (unless \a force is set).
+ */
+void ZTransfer::reportProgress(qint64 received, qint64 total, bool force)
+{
+    m_metrics.bytes = received;
+    if (!force && m_progressTimer.isValid() &&
+        m_progressTimer.elapsed() < ProgressInterval)
+        return;
+
+    m_progressTimer.start();
+    emit progress(received, total);
+}
+
+QString ZTransfer::partFilePath() const
+{
+    return m_downloadDir.filePath(m_fileName + PARTIAL_DOWN);
+}
+
+/**
+ * Checks whether a previous attempt left a partial download of the current
+ * URL behind. If so, adds the range headers needed to continue it to
+ * \a request and returns the number of bytes we already have.
+ *
+ * Partial files that cannot be resumed safely are removed.
+ */
+qint64 ZTransfer::prepareResume(QNetworkRequest &request)
+{
+    QString part = partFilePath();
+
+    QJsonObject info;
+    QFile file(part + RESUME_INFO);
+    if (file.open(QIODevice::ReadOnly))
+        info = QJsonDocument::fromJson(file.readAll()).object();
+
+    m_etag = info.value("etag").toString().toUtf8();
+    m_lastModified = info.value("last_modified").toString().toUtf8();
+
+    /* Weak validators cannot be used with If-Range */
+    QByteArray validator = m_etag;
+    if (validator.isEmpty() || validator.startsWith("W/"))
+        validator = m_lastModified;
+
+    qint64 offset =
+        qMin(info.value("offset").toInteger(), QFileInfo(part).size());
+
+    if (info.value("url").toString() != m_url.toString() ||
+        validator.isEmpty() || offset <= 0) {
+        QFile::remove(part);
+        QFile::remove(part + RESUME_INFO);
+        return 0;
+    }
+
+    /* If the file changed on the server, we get the full file back */
+    request.setRawHeader("Range",
+                         "bytes=" + QByteArray::number(offset) + "-");
+    request.setRawHeader("If-Range", validator);
+
+    qDebug() << "ZTransfer: resuming" << m_fileName << "at" << offset
+             << "bytes";
+    return offset;
+}
+
+/**
+ * Writes the sidecar that allows the partial download to be resumed later.
+ * The offset only counts data the sink has handed to the OS, buffered data
+ * would be lost with the process.
+ */
+void ZTransfer::saveResumeInfo()
+{
+    m_resumeInfoClock.start();
+
+    QJsonObject info;
+    info.insert("url", m_url.toString());
+    info.insert("etag", QString::fromUtf8(m_etag));
+    info.insert("last_modified", QString::fromUtf8(m_lastModified));
+    info.insert("offset", m_resumeOffset + m_sink.bytesWritten());
+
+    QFile file(m_sink.fileName() + RESUME_INFO);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        file.write(QJsonDocument(info).toJson(QJsonDocument::Compact));
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZTRANSFER_H
+#define ZTRANSFER_H
+
+#include "ZContentDecoder.h"
+#include "ZFileSink.h"
+#include "ZMetrics.h"
+#include "ZRateLimiter.h"
+#include <QByteArray>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+#include <ctime>
+
+class QNetworkReply;
+class QNetworkRequest;
+class QNetworkAccessManager;
+class ZSegmentedDownload;
+class ZBlockUpdate;
+class ZDeltaDownload;
+
+/**
+ * Downloads a single file to disk.
+ *
+ * A transfer owns the replies and the file sink, and is meant to live in a
+ * worker thread so that slow disks or hashing never block the user
+ * interface. The network access manager may be shared with other transfers
+ * in the same thread, a private one is created if none is given. It
+ * communicates exclusively through signals, and progress is reported at most
+ * every ProgressInterval milliseconds.
+ *
+ * With metrics enabled, metrics() is emitted right before finished() or
+ * failed() with the timing breakdown of the whole transfer, retries and
+ * fallbacks included.
+ *
+ * A file published compressed (see setCompression()) is decompressed as it
+ * arrives, so only the decompressed file is written to disk and verified.
+ * Such downloads use a single connection and restart rather than resume.
+ *
+ * All setters must be called from the thread the transfer lives in (or
+ * before it is moved to its thread).
+ */
+class ZTransfer : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void progress(qint64 received, qint64 total);
+    void retrying(int attempt);
+    void finished(const QUrl &url, const QString &filePath);
+    void failed(const QString &error);
+    void metrics(const ZMetrics &metrics);
+
+public:
+    static constexpr qint64 DefaultReadBufferSize = 1024 * 1024;
+    static constexpr int ProgressInterval = 100;
+
+    // A connection without data for StallTimeout ms is dropped and resumed
+    // after RetryDelay ms (times the attempt)
+    static constexpr int StallTimeout = 10000;
+    static constexpr int RetryDelay = 2000;
+
+    explicit ZTransfer(QNetworkAccessManager *manager = nullptr,
+                       QObject *parent = nullptr);
+    ~ZTransfer();
+
+    void setDownloadDir(const QString &downloadDir);
+    void setFileName(const QString &file);
+    void setUserAgentString(const QString &agent);
+    void setReadBufferSize(qint64 size);
+    void setSegmentCount(int count);
+    void setExpectedHash(const QByteArray &sha256);
+    void setChecksumsUrl(const QUrl &url);
+    void setBlockIndex(const QUrl &url, const QString &seedFile,
+                       const QUrl &fileUrl = QUrl());
+    void setDelta(const QUrl &url, const QString &baseFile);
+    void setRateLimit(qint64 bytesPerSecond, bool background);
+    void setMetricsEnabled(bool enabled);
+    void setWriteStrategy(const ZWriteStrategy &strategy);
+    void setCompression(ZContentDecoder::Encoding encoding);
+
+public slots:
+    void start(const QUrl &url);
+    void abort();
+
+private slots:
+    void finishedReply();
+    void metaDataChanged();
+    void saveFile();
+    void replyProgress(qint64 received, qint64 total);
+    void segmentedProgress(qint64 received, qint64 total);
+    void segmentedFinished();
+    void segmentedFailed(const QString &error);
+    void rangesUnsupported();
+    void blockUpdateFinished();
+    void blockUpdateFailed(const QString &error);
+    void deltaFinished();
+    void deltaFailed(const QString &error);
+    void checksumsFinished();
+    void probeLatency();
+    void probeFinished();
+
+private:
+    void reportProgress(qint64 received, qint64 total, bool force = false);
+    void noteFirstByte();
+    void reportStats();
+    void reportMetrics(bool ok, const QString &error = QString());
+    void discardReply(const QString &error);
+    void addSinkTimes();
+    qint64 writeReply(qint64 maxSize = -1);
+    bool finishDecoding();
+    QString partFilePath() const;
+    qint64 prepareResume(QNetworkRequest &request);
+    void saveResumeInfo();
+    void completeDownload(const QString &partFile);
+    bool verificationEnabled() const;
+    bool verifyDownload(const QString &partFile, QString *error);
+
+    QDir m_downloadDir;
+    QString m_fileName;
+    QString m_userAgentString;
+    QNetworkAccessManager *m_manager;
+    QNetworkReply *m_reply;
+    qint64 m_readBufferSize;
+    ZFileSink m_sink;
+    ZWriteStrategy m_writeStrategy;
+    ZContentDecoder::Encoding m_compression;
+    ZContentDecoder m_decoder;
+    QByteArray m_decoded;
+    qint64 m_decodeTime;
+    std::clock_t m_cpuStart;
+    QElapsedTimer m_progressTimer;
+    QElapsedTimer m_startClock;
+    QElapsedTimer m_resumeInfoClock;
+    qint64 m_firstByteTime;
+
+    bool m_metricsEnabled;
+    ZMetrics m_metrics;
+
+    QUrl m_url;
+    int m_retries;
+    bool m_cancelled;
+    qint64 m_resumeOffset;
+    QByteArray m_etag;
+    QByteArray m_lastModified;
+
+    QUrl m_checksumsUrl;
+    QString m_checksumName;
+    QString m_completedPart;
+    QByteArray m_expectedHash;
+    QByteArray m_downloadHash;
+    QNetworkReply *m_checksumReply;
+
+    ZRateLimiter m_limiter;
+    QTimer m_throttleTimer;
+    QTimer m_probeTimer;
+    QElapsedTimer m_probeClock;
+    QNetworkReply *m_probeReply;
+
+    int m_segmentCount;
+    bool m_rangesUnsupported;
+    ZSegmentedDownload *m_segmented;
+
+    QUrl m_blockIndexUrl;
+    QUrl m_blockFileUrl;
+    QString m_seedFile;
+    bool m_blockUpdateFailed;
+    ZBlockUpdate *m_blockUpdate;
+
+    QUrl m_deltaUrl;
+    QString m_baseFile;
+    bool m_deltaFailed;
+    ZDeltaDownload *m_delta;
+};
+
+#endif
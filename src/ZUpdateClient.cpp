@@ -0,0 +1,940 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZUpdateClient.h"
+#include "ZTransfer.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QThread>
+
+// Small pages keep the response size down, the cap matches the 30 releases
+// the unpaginated endpoint used to return
+static const int RELEASES_PER_PAGE = 5;
+static const int MAX_RELEASE_PAGES = 6;
+
+ZUpdateClient::ZUpdateClient(const QString &repoOwnerSlashName,
+                             const QString &currentVersion, bool isPortable,
+                             bool skipPrerelease, QObject *parent)
+    : QObject(parent), m_repoOwnerSlashName(repoOwnerSlashName),
+      m_currentVersion(currentVersion),
+      m_version(ZVersion::fromString(currentVersion)),
+      m_isPortable(isPortable), m_skipPrerelease(skipPrerelease),
+      m_network(ZNetworkContext::instance()),
+      m_cache(repoOwnerSlashName, currentVersion, skipPrerelease),
+      m_staging(repoOwnerSlashName)
+{
+    // Detect platform and architecture
+    m_platform = detectPlatform();
+    m_architecture = detectArchitecture();
+
+    qDebug() << "ZUpdateClient: Platform:" << m_platform
+             << "Architecture:" << m_architecture
+             << "Portable:" << m_isPortable;
+}
+
+ZUpdateClient::~ZUpdateClient() { abortDownload(); }
+
+Platform::Type ZUpdateClient::detectPlatform()
+{
+#if defined(Q_OS_WIN)
+    return Platform::Windows;
+#elif defined(Q_OS_MAC) || defined(Q_OS_MACOS)
+    return Platform::MacOS;
+#elif defined(Q_OS_LINUX)
+    return Platform::Linux;
+#else
+    return Platform::Unknown;
+#endif
+}
+
+Architecture::Type ZUpdateClient::detectArchitecture()
+{
+#if defined(Q_PROCESSOR_X86_64) || defined(Q_PROCESSOR_AMD64)
+    return Architecture::x86_64;
+#elif defined(Q_PROCESSOR_ARM_64) || defined(Q_PROCESSOR_AARCH64)
+    return Architecture::ARM64;
+#elif defined(Q_PROCESSOR_ARM)
+    return Architecture::ARM;
+#else
+    return Architecture::Unknown;
+#endif
+}
+
+/**
+ * Looks for a release newer than the running version. The returned future
+ * (and updateAvailable() or noUpdateAvailable()) delivers the download
+ * profile once the answer is known. A check that is already running is not
+ * restarted, its future is returned instead.
+ */
+QFuture<QVariantMap> ZUpdateClient::checkForUpdates()
+{
+    if (m_checking)
+        return m_checkPromise.future();
+
+    m_checkPromise = QPromise<QVariantMap>();
+    m_checkPromise.start();
+    m_checking = true;
+    QFuture<QVariantMap> future = m_checkPromise.future();
+
+    m_checkBytes = 0;
+    m_checkWireBytes = 0;
+    m_checkParseTime = 0;
+    m_checkLatest = QJsonObject();
+    m_checkFoundOlder = false;
+    if (m_metricsEnabled) {
+        m_checkMetrics = ZMetrics("check");
+        m_checkMetrics.clock.start();
+    }
+
+    // Answers known up front are still delivered from the event loop, so
+    // callers can connect to the signals after the call
+    if (m_platform == Platform::Unknown ||
+        m_architecture == Architecture::Unknown) {
+        QMetaObject::invokeMethod(
+            this,
+            [this]() { failCheck(tr("Unknown platform or architecture")); },
+            Qt::QueuedConnection);
+        return future;
+    }
+
+    // Skip the network entirely if we checked recently
+    if (m_cache.load() && m_cache.isFresh(m_cacheTtl)) {
+        qDebug() << "Using cached update check from" << m_cache.filePath();
+        m_checkMetrics.cached = true;
+        QJsonObject release = m_cache.release();
+        QMetaObject::invokeMethod(
+            this, [this, release]() { processRelease(release); },
+            Qt::QueuedConnection);
+        return future;
+    }
+
+    fetchReleases(1);
+    return future;
+}
+
+/**
+ * Tells a repository without stable releases from a missing one once
+ * /releases/latest answered 404, GitHub sends the same "Not Found" body for
+ * both. Only the former means that there is no update.
+ */
+void ZUpdateClient::checkRepository()
+{
+    QUrl url(QString("https://api.github.com/repos/%1")
+                 .arg(m_repoOwnerSlashName));
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::UserAgentHeader, "ZUpdater");
+    ZNetworkContext::prepareRequest(request);
+
+    QNetworkReply *reply = m_network->manager()->get(request);
+    if (m_checkMetrics.clock.isValid())
+        m_checkMetrics.track(reply, this);
+
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+
+        int status =
+            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 404)
+            return failCheck(tr("Repository %1 not found")
+                                 .arg(m_repoOwnerSlashName));
+        if (status != 200)
+            return failCheck(reply->errorString());
+
+        qInfo() << "No releases found";
+        m_cache.setRelease(QJsonObject());
+        m_cache.save();
+        processRelease(QJsonObject());
+    });
+}
+
+/**
+ * Requests a page of the release list. Without prereleases, GitHub can tell
+ * us the newest release directly, otherwise we walk small pages and stop as
+ * soon as the answer is known.
+ */
+void ZUpdateClient::fetchReleases(int page)
+{
+    QString updateUrl;
+    if (m_skipPrerelease) {
+        updateUrl = QString("https://api.github.com/repos/%1/releases/latest")
+                        .arg(m_repoOwnerSlashName);
+    } else {
+        updateUrl =
+            QString("https://api.github.com/repos/%1/releases?per_page=%2"
+                    "&page=%3")
+                .arg(m_repoOwnerSlashName)
+                .arg(RELEASES_PER_PAGE)
+                .arg(page);
+    }
+
+    QNetworkRequest request((QUrl(updateUrl)));
+    request.setHeader(QNetworkRequest::UserAgentHeader, "ZUpdater");
+    ZNetworkContext::prepareRequest(request);
+
+    // The release list is mostly markdown and URLs, it compresses well
+    ZContentDecoder::negotiate(request);
+
+    // Conditional requests answered with 304 don't count against the
+    // GitHub rate limit. New releases always show up on the first page.
+    if (page == 1)
+        m_cache.applyValidators(request);
+
+    m_parser.reset();
+    m_decoder.reset();
+    QNetworkReply *reply = m_network->manager()->get(request);
+    if (m_checkMetrics.clock.isValid()) {
+        if (page == 1)
+            m_checkMetrics.url = request.url();
+        m_checkMetrics.track(reply, this);
+    }
+
+    // Parse the release list while it arrives and hang up as soon as we
+    // know the answer
+    QObject::connect(reply, &QNetworkReply::readyRead, this, [this, reply,
+                                                               page]() {
+        int status =
+            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status != 200 || !readReleases(reply))
+            return;
+
+        if (page == 1)
+            m_cache.updateValidators(reply);
+
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+        finishCheck(page);
+    });
+
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply,
+                                                              page]() {
+        qDebug() << "Update check reply received";
+        reply->deleteLater();
+
+        int status =
+            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+        // /releases/latest answers 404 when there is no stable release, but
+        // also when the repository doesn't exist (or isn't visible to us)
+        if (m_skipPrerelease && status == 404) {
+            m_cache.updateValidators(reply);
+            return checkRepository();
+        }
+
+        if (reply->error() != QNetworkReply::NoError)
+            return failCheck(reply->errorString());
+
+        if (status == 304 && m_cache.isValid()) {
+            qDebug() << "Releases not modified, using cached result";
+            m_checkMetrics.cached = true;
+            m_cache.save();
+            return processRelease(m_cache.release());
+        }
+
+        if (page == 1)
+            m_cache.updateValidators(reply);
+
+        if (readReleases(reply))
+            return finishCheck(page);
+
+        if (m_decoder.hasError())
+            return failCheck(tr("Cannot decode the release list: %1")
+                                 .arg(m_decoder.errorString()));
+
+        if (m_parser.hasError() || !m_parser.atEnd())
+            return failCheck(tr("Invalid response format: %1")
+                                 .arg(m_parser.errorString()));
+
+        // Releases are listed newest first, once we have seen one that is
+        // not newer than ours there is no point in asking for older pages
+        if (!m_skipPrerelease && !m_checkFoundOlder &&
+            m_parser.releaseCount() == RELEASES_PER_PAGE &&
+            page < MAX_RELEASE_PAGES)
+            return fetchReleases(page + 1);
+
+        if (m_parser.releaseCount() == 0 && page == 1)
+            qInfo() << "No releases found";
+
+        finishCheck(page);
+    });
+}
+
+/**
+ * Feeds the data available in \a reply to the release parser, decompressed
+ * if the server compressed it, and looks at every release that has been
+ * completed. Returns true once a newer release has been found.
+ */
+bool ZUpdateClient::readReleases(QNetworkReply *reply)
+{
+    QByteArray wire = reply->readAll();
+    m_checkWireBytes += wire.size();
+
+    // The headers are final once the body arrives
+    if (!m_decoder.isStarted())
+        m_decoder.start(ZContentDecoder::encodingOf(reply));
+
+    QByteArray data;
+    if (!m_decoder.decode(wire, &data))
+        return false;
+    m_checkBytes += data.size();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool found = false;
+    if (m_parser.feed(data)) {
+        while (!found && m_parser.hasRelease())
+            found = considerRelease(m_parser.takeRelease());
+    }
+
+    m_checkParseTime += timer.nsecsElapsed();
+    return found;
+}
+
+/**
+ * Returns true if \a releaseObj is newer than the running version
+ */
+bool ZUpdateClient::considerRelease(const QJsonObject &releaseObj)
+{
+    if (m_skipPrerelease) {
+        if (releaseObj.value("prerelease").toBool())
+            return false;
+    }
+    QString tagName = releaseObj.value("tag_name").toString();
+    if (tagName.isEmpty())
+        return false;
+
+    ZVersion version = ZVersion::fromString(tagName);
+    if (!version.isValid())
+        return false;
+
+    if (version <= m_version) {
+        m_checkFoundOlder = true;
+        return false;
+    }
+
+    m_checkLatest = releaseObj;
+    qDebug() << "Found newer release version:" << tagName;
+    return true;
+}
+
+void ZUpdateClient::finishCheck(int page)
+{
+    qDebug().noquote() << "Update check transferred" << m_checkWireBytes
+                       << "bytes," << m_checkBytes << "decoded from"
+                       << ZContentDecoder::name(m_decoder.encoding()) << "in"
+                       << page << "request(s), JSON parsing took"
+                       << m_checkParseTime / 1000 << "us";
+
+    // Remember the result, an unchanged release list won't be parsed again
+    m_cache.setRelease(m_checkLatest);
+    m_cache.save();
+
+    processRelease(m_checkLatest);
+}
+
+/**
+ * Builds the download profile of \a latestVersionObj, the newest release,
+ * and completes the check
+ */
+void ZUpdateClient::processRelease(const QJsonObject &latestVersionObj)
+{
+    m_checking = false;
+    reportCheckMetrics(true);
+
+    if (latestVersionObj.isEmpty()) {
+        // Whatever was staged has been installed or withdrawn
+        m_staging.evict();
+        m_checkPromise.addResult(QVariantMap());
+        m_checkPromise.finish();
+        emit noUpdateAvailable();
+        return;
+    }
+
+    QVariantMap downloadProfile;
+    downloadProfile["body"] = latestVersionObj.value("body").toString();
+    downloadProfile["tag_name"] = latestVersionObj.value("tag_name").toString();
+    downloadProfile["html_url"] = latestVersionObj.value("html_url").toString();
+
+    QJsonArray assets = latestVersionObj.value("assets").toArray();
+    QString assetPattern = detectAssetPattern();
+    qDebug() << "Looking for asset matching pattern:" << assetPattern;
+
+    QJsonObject obj = getMatchingAsset(assetPattern, assets);
+    if (obj.isEmpty()) {
+        qWarning() << "No matching asset found for the platform/architecture";
+    } else {
+        downloadProfile["browser_download_url"] =
+            obj.value("browser_download_url").toString();
+
+        // A compressed asset is decompressed while it downloads, everything
+        // else (name, checksum, block index, patch) is about the plain file
+        QString plainName;
+        ZContentDecoder::Encoding encoding = ZContentDecoder::fileEncoding(
+            obj.value("name").toString(), &plainName);
+        QJsonObject plain = obj;
+        if (encoding != ZContentDecoder::Identity) {
+            downloadProfile["encoding"] =
+                QString::fromLatin1(ZContentDecoder::name(encoding));
+            downloadProfile["download_size"] = obj.value("size").toInteger();
+            plain = findAsset(plainName, assets);
+            if (plain.isEmpty())
+                plain.insert("name", plainName);
+        }
+
+        downloadProfile["file_name"] = plain.value("name").toString();
+        downloadProfile["size"] =
+            plain.value("size").toInteger(obj.value("size").toInteger());
+        addChecksums(downloadProfile, plain, assets);
+        if (m_platform == Platform::Linux)
+            addBlockIndex(downloadProfile, plain, assets);
+        addDelta(downloadProfile, plain, assets);
+
+        qDebug() << "Download url:"
+                 << obj.value("browser_download_url").toString();
+    }
+
+    m_checkPromise.addResult(downloadProfile);
+    m_checkPromise.finish();
+    emit updateAvailable(downloadProfile);
+}
+
+void ZUpdateClient::failCheck(const QString &error)
+{
+    qWarning() << "Failed to fetch updates:" << error;
+    m_checking = false;
+    reportCheckMetrics(false, error);
+    m_checkPromise.finish();
+    emit checkFailed(error);
+}
+
+/**
+ * Completes the metrics of the current check, if they are being collected
+ */
+void ZUpdateClient::reportCheckMetrics(bool ok, const QString &error)
+{
+    if (!m_checkMetrics.clock.isValid())
+        return;
+
+    m_checkMetrics.bytes = m_checkBytes;
+    m_checkMetrics.wireBytes = m_checkWireBytes;
+    if (m_decoder.isStarted())
+        m_checkMetrics.encoding =
+            QString::fromLatin1(ZContentDecoder::name(m_decoder.encoding()));
+    m_checkMetrics.parseTime = m_checkParseTime;
+    m_checkMetrics.finish(ok, error);
+    publishMetrics(m_checkMetrics);
+}
+
+/**
+ * Returns the literal suffix matched by an asset pattern of the form
+ * ".*<literal>$", or an empty string if the pattern needs a real regex
+ */
+static QString literalSuffix(const QString &pattern)
+{
+    if (!pattern.startsWith(".*") || !pattern.endsWith('$'))
+        return QString();
+
+    // Escaped dots are the only metacharacters allowed in the literal
+    QString suffix = pattern.mid(2, pattern.size() - 3);
+    QString rest = QString(suffix).remove("\\.");
+    static const QRegularExpression special("[\\\\^$.|?*+()\\[\\]{}]");
+    if (rest.isEmpty() || rest.contains(special))
+        return QString();
+
+    return suffix.replace("\\.", ".");
+}
+
+/**
+ * Returns the asset for this platform. A compressed copy of it that we can
+ * decompress while downloading is preferred over the plain file.
+ */
+QJsonObject ZUpdateClient::getMatchingAsset(const QString &assetPattern,
+                                            const QJsonArray &assets)
+{
+    // Compile the pattern only once, the platform patterns are plain
+    // suffixes that don't need the regex engine at all
+    if (m_assetRegex.pattern() != assetPattern) {
+        m_assetRegex = QRegularExpression(
+            assetPattern, QRegularExpression::CaseInsensitiveOption);
+        m_assetRegex.optimize();
+        m_assetSuffix = literalSuffix(assetPattern);
+    }
+
+    QJsonObject plain;
+    for (const QJsonValue &a : assets) {
+        if (!a.isObject())
+            continue;
+        QJsonObject obj = a.toObject();
+        QString name = obj.value("name").toString();
+        if (name.isEmpty())
+            continue;
+
+        // Match compressed assets by the name of the file they contain
+        ZContentDecoder::Encoding encoding =
+            ZContentDecoder::fileEncoding(name, &name);
+        if (!ZContentDecoder::isSupported(encoding))
+            continue;
+
+        bool matches = m_assetSuffix.isEmpty()
+                           ? m_assetRegex.match(name).hasMatch()
+                           : name.endsWith(m_assetSuffix, Qt::CaseInsensitive);
+        if (!matches)
+            continue;
+
+        if (encoding != ZContentDecoder::Identity)
+            return obj;
+        if (plain.isEmpty())
+            plain = obj;
+    }
+
+    return plain;
+}
+
+QJsonObject ZUpdateClient::findAsset(const QString &name,
+                                     const QJsonArray &assets)
+{
+    for (const QJsonValue &a : assets) {
+        QJsonObject obj = a.toObject();
+        if (obj.value("name").toString() == name)
+            return obj;
+    }
+
+    return QJsonObject();
+}
+
+/**
+ * Adds the published SHA-256 of \a asset to the download profile. GitHub
+ * reports it in the asset "digest" field, older releases may instead ship a
+ * SHA256SUMS list (or a per-file .sha256) next to the asset.
+ */
+void ZUpdateClient::addChecksums(QVariantMap &downloadProfile,
+                                 const QJsonObject &asset,
+                                 const QJsonArray &assets)
+{
+    QString digest = asset.value("digest").toString();
+    if (digest.startsWith("sha256:")) {
+        downloadProfile["sha256"] = digest.mid(7);
+        return;
+    }
+
+    QString name = asset.value("name").toString();
+    QStringList candidates = {name + ".sha256", "SHA256SUMS",
+                              "SHA256SUMS.txt", "sha256sums.txt",
+                              "checksums.txt"};
+
+    for (const QString &candidate : candidates) {
+        for (const QJsonValue &a : assets) {
+            QJsonObject obj = a.toObject();
+            if (obj.value("name").toString().compare(
+                    candidate, Qt::CaseInsensitive) == 0) {
+                downloadProfile["checksums_url"] =
+                    obj.value("browser_download_url").toString();
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Adds the block index published by the AppImage tooling for \a asset, so
+ * that the running AppImage can be used to avoid downloading the blocks that
+ * did not change. The blocks are fetched from \a asset itself, which must
+ * therefore be published uncompressed.
+ */
+void ZUpdateClient::addBlockIndex(QVariantMap &downloadProfile,
+                                  const QJsonObject &asset,
+                                  const QJsonArray &assets)
+{
+    QString appImage = qEnvironmentVariable("APPIMAGE");
+    QString fileUrl = asset.value("browser_download_url").toString();
+    if (appImage.isEmpty() || fileUrl.isEmpty())
+        return;
+
+    QString name = asset.value("name").toString() + ".zsync";
+    for (const QJsonValue &a : assets) {
+        QJsonObject obj = a.toObject();
+        if (obj.value("name").toString() == name) {
+            downloadProfile["zsync_url"] =
+                obj.value("browser_download_url").toString();
+            downloadProfile["seed_file"] = appImage;
+            downloadProfile["zsync_file_url"] = fileUrl;
+            return;
+        }
+    }
+}
+
+/**
+ * Adds the patch that turns the installed version into \a asset, made with
+ * "zstd --patch-from=<old asset> <asset>" (see findDelta() for the names).
+ * The full asset remains the fallback and its checksum is used to verify
+ * the patched file.
+ */
+void ZUpdateClient::addDelta(QVariantMap &downloadProfile,
+                             const QJsonObject &asset,
+                             const QJsonArray &assets)
+{
+    QString installed = installedFile();
+    if (installed.isEmpty() || !m_version.isValid())
+        return;
+
+    ZVersion release =
+        ZVersion::fromString(downloadProfile.value("tag_name").toString());
+    QJsonObject patch = findDelta(asset, assets, m_version, release);
+    if (patch.isEmpty())
+        return;
+
+    downloadProfile["delta_url"] =
+        patch.value("browser_download_url").toString();
+    downloadProfile["base_file"] = installed;
+}
+
+/**
+ * Returns the patch in \a assets that turns version \a from of \a asset
+ * into version \a to, or an empty object. Patches are published next to the
+ * asset under either name:
+ *
+ * - "<app>-<from>_to_<to>-<platform>.patch", where <platform> is the part
+ *   of the asset name after its last "-", e.g. "Linux_x86_64" for
+ *   "App-2.1.0-Linux_x86_64.AppImage", and <app> starts the asset name.
+ * - "<asset name>.from-<from>.patch", for assets that share a platform,
+ *   e.g. the installer and the portable archive on Windows.
+ */
+QJsonObject ZUpdateClient::findDelta(const QJsonObject &asset,
+                                     const QJsonArray &assets,
+                                     const ZVersion &from, const ZVersion &to)
+{
+    if (!from.isValid() || !to.isValid())
+        return QJsonObject();
+
+    static const QString extension = ".patch";
+    static const QString separator = "_to_";
+
+    QString assetName = asset.value("name").toString();
+    QString prefix = assetName + ".from-";
+
+    QString platform;
+    int dash = assetName.lastIndexOf('-');
+    if (dash > 0) {
+        platform = assetName.mid(dash + 1);
+        platform = platform.left(platform.indexOf('.'));
+    }
+    QString suffix = '-' + platform + extension;
+
+    for (const QJsonValue &a : assets) {
+        QJsonObject obj = a.toObject();
+        QString name = obj.value("name").toString();
+
+        if (name.startsWith(prefix) && name.endsWith(extension)) {
+            ZVersion version = ZVersion::fromString(name.mid(
+                prefix.size(), name.size() - prefix.size() - extension.size()));
+            if (version.isValid() && version == from)
+                return obj;
+            continue;
+        }
+
+        if (platform.isEmpty() || !name.endsWith(suffix))
+            continue;
+
+        // <app>-<from>_to_<to>, the versions may contain dashes themselves
+        QString versions = name.chopped(suffix.size());
+        int split = versions.lastIndexOf(separator);
+        if (split < 0)
+            continue;
+
+        ZVersion target =
+            ZVersion::fromString(versions.mid(split + separator.size()));
+        if (!target.isValid() || target != to)
+            continue;
+
+        QString head = versions.left(split);
+        for (int i = head.indexOf('-'); i > 0; i = head.indexOf('-', i + 1)) {
+            ZVersion source = ZVersion::fromString(head.mid(i + 1));
+            if (assetName.startsWith(head.left(i + 1)) && source.isValid() &&
+                source == from)
+                return obj;
+        }
+    }
+
+    return QJsonObject();
+}
+
+QString ZUpdateClient::detectAssetPattern() const
+{
+    QString pattern;
+
+    if (m_platform == Platform::Windows) {
+        QString arch =
+            (m_architecture == Architecture::x86_64) ? "x86_64" : "arm64";
+        if (m_isPortable) {
+            pattern = QString(".*-Windows_%1\\.portable\\.zip$").arg(arch);
+        } else {
+            pattern = QString(".*-Windows_%1\\.msi$").arg(arch);
+        }
+    } else if (m_platform == Platform::MacOS) {
+        if (m_architecture == Architecture::x86_64) {
+            pattern = ".*-Apple_Intel\\.dmg$";
+        } else if (m_architecture == Architecture::ARM64) {
+            pattern = ".*-Apple_Silicon\\.dmg$";
+        }
+    } else if (m_platform == Platform::Linux) {
+        QString arch =
+            (m_architecture == Architecture::x86_64) ? "x86_64" : "arm64";
+        pattern = QString(".*-Linux_%1\\.appimage$").arg(arch);
+    }
+
+    return pattern;
+}
+
+/**
+ * Downloads the asset of \a downloadProfile into \a downloadDir and verifies
+ * it. The returned future (and downloadFinished()) delivers the path of the
+ * file. Only one download runs at a time, a running one is aborted.
+ */
+QFuture<QString> ZUpdateClient::download(const QVariantMap &downloadProfile,
+                                         const QString &downloadDir)
+{
+    abortDownload();
+    m_stagingProfile.clear();
+    return startDownload(downloadProfile, downloadDir, m_backgroundDownload);
+}
+
+/**
+ * Downloads the asset of \a downloadProfile into the staging area at low
+ * priority, unless it is already there. The returned future (and
+ * updateStaged()) delivers the path of the verified file, which stays in the
+ * staging area until a check finds the application up to date or a newer
+ * release is staged.
+ *
+ * Assets larger than the staging size limit are not staged, the future
+ * finishes without a result and downloadFailed() is emitted.
+ */
+QFuture<QString> ZUpdateClient::stage(const QVariantMap &downloadProfile)
+{
+    abortDownload();
+
+    QString staged = m_staging.stagedFile(downloadProfile);
+    if (!staged.isEmpty()) {
+        qDebug() << "ZUpdateClient: update already staged in" << staged;
+        QPromise<QString> promise;
+        promise.start();
+        promise.addResult(staged);
+        promise.finish();
+        emit updateStaged(downloadProfile, staged);
+        return promise.future();
+    }
+
+    if (!m_staging.fits(downloadProfile)) {
+        QPromise<QString> promise;
+        promise.start();
+        promise.finish();
+        emit downloadFailed(tr("The update is too large to be staged"));
+        return promise.future();
+    }
+
+    // Only the newest release is kept, partial downloads of it are resumed
+    m_staging.evict(downloadProfile.value("tag_name").toString());
+    m_stagingProfile = downloadProfile;
+    return startDownload(downloadProfile,
+                         m_staging.directoryFor(downloadProfile), true);
+}
+
+/**
+ * Returns the path of the staged asset of \a downloadProfile, or an empty
+ * string if it isn't staged
+ */
+QString ZUpdateClient::stagedFile(const QVariantMap &downloadProfile) const
+{
+    return m_staging.stagedFile(downloadProfile);
+}
+
+QFuture<QString>
+ZUpdateClient::startDownload(const QVariantMap &downloadProfile,
+                             const QString &downloadDir, bool background)
+{
+    m_downloadPromise = QPromise<QString>();
+    m_downloadPromise.start();
+    QFuture<QString> future = m_downloadPromise.future();
+
+    QUrl url(downloadProfile.value("browser_download_url").toString());
+    if (!url.isValid()) {
+        m_downloadPromise.finish();
+        emit downloadFailed(tr("No asset to download"));
+        return future;
+    }
+
+    // Network and disk I/O happen in the shared transfer thread
+    m_transfer = new ZTransfer(m_network->transferManager());
+    m_transfer->moveToThread(m_network->transferThread());
+    connect(m_network->transferThread(), SIGNAL(finished()), m_transfer,
+            SLOT(deleteLater()));
+    connect(m_transfer, SIGNAL(progress(qint64, qint64)), this,
+            SLOT(transferProgress(qint64, qint64)));
+    connect(m_transfer, SIGNAL(finished(QUrl, QString)), this,
+            SLOT(transferFinished(QUrl, QString)));
+    connect(m_transfer, SIGNAL(failed(QString)), this,
+            SLOT(transferFailed(QString)));
+    connect(m_transfer, SIGNAL(metrics(ZMetrics)), this,
+            SLOT(publishMetrics(ZMetrics)));
+
+    ZTransfer *transfer = m_transfer;
+    QString fileName = downloadProfile.value("file_name").toString();
+    int segmentCount = m_downloadSegmentCount;
+    qint64 rateLimit = m_downloadRateLimit;
+    ZWriteStrategy writeStrategy = m_writeStrategy;
+    bool metricsEnabled = m_metricsEnabled;
+    QByteArray sha256 = downloadProfile.value("sha256").toString().toUtf8();
+    QUrl checksumsUrl(downloadProfile.value("checksums_url").toString());
+    QUrl blockIndexUrl(downloadProfile.value("zsync_url").toString());
+    QUrl blockFileUrl(downloadProfile.value("zsync_file_url").toString());
+    QString seedFile = downloadProfile.value("seed_file").toString();
+    QUrl deltaUrl(downloadProfile.value("delta_url").toString());
+    QString baseFile = downloadProfile.value("base_file").toString();
+    ZContentDecoder::Encoding compression = ZContentDecoder::fromName(
+        downloadProfile.value("encoding").toString().toLatin1());
+
+    QMetaObject::invokeMethod(transfer, [=]() {
+        transfer->setDownloadDir(downloadDir);
+        transfer->setFileName(fileName);
+        transfer->setSegmentCount(segmentCount);
+        transfer->setRateLimit(rateLimit, background);
+        transfer->setWriteStrategy(writeStrategy);
+        transfer->setMetricsEnabled(metricsEnabled);
+        transfer->setExpectedHash(sha256);
+        transfer->setChecksumsUrl(checksumsUrl);
+        transfer->setBlockIndex(blockIndexUrl, seedFile, blockFileUrl);
+        transfer->setDelta(deltaUrl, baseFile);
+        transfer->setCompression(compression);
+        transfer->start(url);
+    });
+
+    return future;
+}
+
+/**
+ * Cancels the running download, its future finishes without a result
+ */
+void ZUpdateClient::abortDownload()
+{
+    if (!m_transfer)
+        return;
+
+    // Don't wait for the transfer thread, it may be busy or stopping. The
+    // abort runs there before the deletion, and before the next download
+    // starts, so the two never touch the same file at once.
+    if (m_transfer->thread()->isRunning())
+        QMetaObject::invokeMethod(m_transfer, "abort", Qt::QueuedConnection);
+    releaseTransfer();
+    m_downloadPromise.finish();
+}
+
+void ZUpdateClient::transferProgress(qint64 received, qint64 total)
+{
+    // Ignore what a released transfer reported before it was disconnected
+    if (sender() != m_transfer)
+        return;
+
+    if (total > 0)
+        m_downloadPromise.setProgressRange(0, 100);
+    m_downloadPromise.setProgressValue(total > 0 ? received * 100 / total
+                                                 : 0);
+    emit downloadProgress(received, total);
+}
+
+void ZUpdateClient::transferFinished(const QUrl &url, const QString &filePath)
+{
+    Q_UNUSED(url);
+    if (sender() != m_transfer)
+        return;
+
+    releaseTransfer();
+
+    // The manifest marks the staged file as complete and verified
+    QVariantMap staged = m_stagingProfile;
+    m_stagingProfile.clear();
+    if (!staged.isEmpty() && !m_staging.add(staged, filePath))
+        qWarning() << "ZUpdateClient: cannot record staged update" << filePath;
+
+    m_downloadPromise.addResult(filePath);
+    m_downloadPromise.finish();
+    emit downloadFinished(filePath);
+    if (!staged.isEmpty())
+        emit updateStaged(staged, filePath);
+}
+
+void ZUpdateClient::transferFailed(const QString &error)
+{
+    if (sender() != m_transfer)
+        return;
+
+    releaseTransfer();
+    m_stagingProfile.clear();
+    m_downloadPromise.finish();
+    emit downloadFailed(error);
+}
+
+void ZUpdateClient::publishMetrics(const ZMetrics &result)
+{
+    if (!m_metricsFile.isEmpty() && !result.appendTo(m_metricsFile))
+        qWarning() << "ZUpdateClient: cannot write metrics to"
+                   << m_metricsFile;
+
+    emit metrics(result);
+}
+
+void ZUpdateClient::releaseTransfer()
+{
+    if (!m_transfer)
+        return;
+
+    m_transfer->disconnect(this);
+    m_transfer->deleteLater();
+    m_transfer = nullptr;
+}
+
+/**
+ * Lets checkForUpdates() reuse the cached result of a check that is less
+ * than \a seconds old without contacting the server. Older results are
+ * still revalidated with a conditional request. 0 disables the window.
+ */
+void ZUpdateClient::setCacheTtl(int seconds) { m_cacheTtl = qMax(0, seconds); }
+
+void ZUpdateClient::setCacheDir(const QString &dir)
+{
+    m_cache.setCacheDir(dir);
+}
+
+QString ZUpdateClient::installedFile() const
+{
+    if (!m_installedFile.isEmpty() || m_platform != Platform::Linux)
+        return m_installedFile;
+
+    return qEnvironmentVariable("APPIMAGE");
+}
+
+void ZUpdateClient::setNetworkContext(ZNetworkContext *network)
+{
+    m_network = network ? network : ZNetworkContext::instance();
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZUPDATE_CLIENT_H
+#define ZUPDATE_CLIENT_H
+
+#include "ZContentDecoder.h"
+#include "ZFileSink.h"
+#include "ZMetrics.h"
+#include "ZNetworkContext.h"
+#include "ZReleaseCache.h"
+#include "ZReleaseParser.h"
+#include "ZStagingArea.h"
+#include "ZVersion.h"
+#include <QFuture>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QPointer>
+#include <QPromise>
+#include <QRegularExpression>
+#include <QString>
+#include <QVariantMap>
+
+class QNetworkReply;
+class ZTransfer;
+
+struct Platform {
+    enum Type { Windows, MacOS, Linux, Unknown };
+};
+
+struct Architecture {
+    enum Type { x86_64, ARM64, ARM, Unknown };
+};
+
+/**
+ * Checks for, downloads and verifies updates without any user interface.
+ *
+ * checkForUpdates() looks for a GitHub release newer than the running
+ * version and selects the asset for this platform. The result is a download
+ * profile: a map with the release ("tag_name", "body", "html_url") and, if a
+ * matching asset was found, everything needed to download and verify it
+ * ("browser_download_url", "file_name", "sha256" or "checksums_url", and the
+ * optional block index and delta patch). download() fetches it in the shared
+ * transfer thread.
+ *
+ * An asset published compressed next to the plain one ("<asset>.zst" or
+ * "<asset>.xz") is preferred if the build can decompress it. The profile
+ * then names it in "encoding", with its size in "download_size", while
+ * "file_name", "size" and the checksum describe the decompressed file that
+ * ends up on disk.
+ *
+ * Both steps report through signals and return a QFuture. A failed step
+ * finishes its future without a result. The signals are never emitted
+ * before the call returns, not even for a check answered from the cache.
+ *
+ * stage() is download() ahead of time: the asset is fetched at low priority
+ * into the staging area and kept there, verified, across restarts until the
+ * user accepts the update (see stagedFile()).
+ *
+ * Only QtCore and QtNetwork are needed, ZUpdater builds its dialogs on top
+ * of this class.
+ */
+class ZUpdateClient : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void updateAvailable(const QVariantMap &downloadProfile);
+    void noUpdateAvailable();
+    void checkFailed(const QString &error);
+
+    void downloadProgress(qint64 received, qint64 total);
+    void downloadFinished(const QString &filePath);
+    void downloadFailed(const QString &error);
+    void updateStaged(const QVariantMap &downloadProfile,
+                      const QString &filePath);
+
+    void metrics(const ZMetrics &metrics);
+
+public:
+    ZUpdateClient(const QString &repoOwnerSlashName,
+                  const QString &currentVersion, bool isPortable = false,
+                  bool skipPrerelease = false, QObject *parent = nullptr);
+    ~ZUpdateClient();
+
+    // Result: the download profile, empty if there is no newer release
+    QFuture<QVariantMap> checkForUpdates();
+    bool isChecking() const { return m_checking; }
+
+    // Result: the path of the verified download
+    QFuture<QString> download(const QVariantMap &downloadProfile,
+                              const QString &downloadDir);
+    bool isDownloading() const { return !m_transfer.isNull(); }
+    void abortDownload();
+
+    // Result: the path of the staged download
+    QFuture<QString> stage(const QVariantMap &downloadProfile);
+    QString stagedFile(const QVariantMap &downloadProfile) const;
+
+    // Directory and size limit of staged downloads
+    QString stagingDir() const { return m_staging.dir(); }
+    void setStagingDir(const QString &dir) { m_staging.setDir(dir); }
+    qint64 stagingSizeLimit() const { return m_staging.sizeLimit(); }
+    void setStagingSizeLimit(qint64 bytes) { m_staging.setSizeLimit(bytes); }
+
+    // Release check cache
+    void setCacheTtl(int seconds);
+    void setCacheDir(const QString &dir);
+
+    // Number of concurrent connections used to download the update
+    int downloadSegmentCount() const { return m_downloadSegmentCount; }
+    void setDownloadSegmentCount(int count) { m_downloadSegmentCount = count; }
+
+    // Bandwidth used by downloads, in bytes per second (0 for no limit), and
+    // whether they back off when the link gets congested
+    qint64 downloadRateLimit() const { return m_downloadRateLimit; }
+    void setDownloadRateLimit(qint64 bytesPerSecond)
+    {
+        m_downloadRateLimit = bytesPerSecond;
+    }
+    bool isBackgroundDownload() const { return m_backgroundDownload; }
+    void setBackgroundDownload(bool background)
+    {
+        m_backgroundDownload = background;
+    }
+
+    // How downloads are written to disk
+    ZWriteStrategy writeStrategy() const { return m_writeStrategy; }
+    void setWriteStrategy(const ZWriteStrategy &strategy)
+    {
+        m_writeStrategy = strategy;
+    }
+
+    // Timing breakdown of every check and download, emitted through
+    // metrics() and appended as JSON lines to the metrics file if one is set
+    bool isMetricsEnabled() const { return m_metricsEnabled; }
+    void setMetricsEnabled(bool enabled) { m_metricsEnabled = enabled; }
+    QString metricsFile() const { return m_metricsFile; }
+    void setMetricsFile(const QString &path) { m_metricsFile = path; }
+
+    // Installed copy of the application that delta updates are applied to,
+    // the running AppImage by default
+    QString installedFile() const;
+    void setInstalledFile(const QString &path) { m_installedFile = path; }
+
+    // Network stack used for checks and downloads, shared by default
+    ZNetworkContext *networkContext() const { return m_network; }
+    void setNetworkContext(ZNetworkContext *network);
+
+    // Platform/Architecture info getters
+    Platform::Type platform() const { return m_platform; }
+    Architecture::Type architecture() const { return m_architecture; }
+    bool isPortable() const { return m_isPortable; }
+    static Platform::Type detectPlatform();
+    static Architecture::Type detectArchitecture();
+    QString detectAssetPattern() const;
+
+    // The asset of a release that matches a detectAssetPattern() pattern
+    QJsonObject getMatchingAsset(const QString &assetPattern,
+                                 const QJsonArray &assets);
+    static QJsonObject findDelta(const QJsonObject &asset,
+                                 const QJsonArray &assets,
+                                 const ZVersion &from, const ZVersion &to);
+
+private slots:
+    void transferProgress(qint64 received, qint64 total);
+    void transferFinished(const QUrl &url, const QString &filePath);
+    void transferFailed(const QString &error);
+    void publishMetrics(const ZMetrics &result);
+
+private:
+    static QJsonObject findAsset(const QString &name, const QJsonArray &assets);
+    void addChecksums(QVariantMap &downloadProfile, const QJsonObject &asset,
+                      const QJsonArray &assets);
+    void addBlockIndex(QVariantMap &downloadProfile, const QJsonObject &asset,
+                       const QJsonArray &assets);
+    void addDelta(QVariantMap &downloadProfile, const QJsonObject &asset,
+                  const QJsonArray &assets);
+    void fetchReleases(int page);
+    void checkRepository();
+    bool readReleases(QNetworkReply *reply);
+    bool considerRelease(const QJsonObject &releaseObj);
+    void finishCheck(int page);
+    void processRelease(const QJsonObject &latestVersionObj);
+    void failCheck(const QString &error);
+    void reportCheckMetrics(bool ok, const QString &error = QString());
+    void releaseTransfer();
+    QFuture<QString> startDownload(const QVariantMap &downloadProfile,
+                                   const QString &downloadDir,
+                                   bool background);
+
+    QString m_repoOwnerSlashName;
+    QString m_currentVersion;
+    ZVersion m_version;
+    bool m_isPortable;
+    bool m_skipPrerelease;
+
+    Platform::Type m_platform;
+    Architecture::Type m_architecture;
+
+    ZNetworkContext *m_network;
+    int m_downloadSegmentCount = 1;
+    qint64 m_downloadRateLimit = 0;
+    bool m_backgroundDownload = false;
+    ZWriteStrategy m_writeStrategy;
+    QString m_installedFile;
+    bool m_metricsEnabled = false;
+    QString m_metricsFile;
+
+    QRegularExpression m_assetRegex;
+    QString m_assetSuffix;
+
+    ZReleaseCache m_cache;
+    int m_cacheTtl = 0;
+
+    // State and statistics of the current check
+    bool m_checking = false;
+    QPromise<QVariantMap> m_checkPromise;
+    ZReleaseParser m_parser;
+    ZContentDecoder m_decoder;
+    QJsonObject m_checkLatest;
+    bool m_checkFoundOlder = false;
+    qint64 m_checkBytes = 0;
+    qint64 m_checkWireBytes = 0;
+    qint64 m_checkParseTime = 0;
+    ZMetrics m_checkMetrics;
+
+    // Current download
+    QPointer<ZTransfer> m_transfer;
+    QPromise<QString> m_downloadPromise;
+
+    // Pre-staged downloads, the profile is only set while staging
+    ZStagingArea m_staging;
+    QVariantMap m_stagingProfile;
+};
+
+#endif
@@ -22,6 +22,7 @@
 
 #include "ZUpdater.h"
 #include "ZDownloader.h"
+#include "ZUpdaterGroup.h"
 #include <QDesktopServices>
 #include <QMessageBox>
 #include <QScrollArea>
@@ -32,20 +33,20 @@ ZUpdater::ZUpdater(const QString &repoOwnerSlashName,
                    UpdateProcedure updateProcedure, bool isPortable,
                    bool isPackageManagerManaged, bool skipPrerelease,
                    QObject *parent)
-    : QObject(parent), m_repoOwnerSlashName(repoOwnerSlashName),
-      m_currentVersion(currentVersion), m_applicationName(applicationName),
-      m_networkManager(new QNetworkAccessManager(this)),
-      m_isPortable(isPortable),
+    : QObject(parent),
+      m_client(new ZUpdateClient(repoOwnerSlashName, currentVersion,
+                                 isPortable, skipPrerelease, this)),
+      m_applicationName(applicationName),
       m_isPackageManagerManaged(isPackageManagerManaged),
-      m_skipPrerelease(skipPrerelease), m_updateProcedure(updateProcedure)
+      m_updateProcedure(updateProcedure)
 {
-    // Detect platform and architecture
-    m_platform = detectPlatform();
-    m_architecture = detectArchitecture();
-
-    qDebug() << "ZUpdater: Platform:" << m_platform
-             << "Architecture:" << m_architecture
-             << "Portable:" << m_isPortable;
+    connect(m_client, &ZUpdateClient::updateAvailable, this,
+            &ZUpdater::processUpdate);
+    connect(m_client, &ZUpdateClient::metrics, this, &ZUpdater::metrics);
+    connect(m_client, &ZUpdateClient::updateStaged, this,
+            &ZUpdater::updateStaged);
+    connect(m_client, &ZUpdateClient::downloadFailed, this,
+            &ZUpdater::stagingFailed);
 }
 
 ZUpdater::~ZUpdater() {}
@@ -66,177 +67,69 @@ void ZUpdater::setDownloadPromptMessage(const QString &msg)
     m_downloadPromptMsg = msg;
 }
 
-Platform::Type ZUpdater::detectPlatform()
-{
-#if defined(Q_OS_WIN)
-    return Platform::Windows;
-#elif defined(Q_OS_MAC) || defined(Q_OS_MACOS)
-    return Platform::MacOS;
-#elif defined(Q_OS_LINUX)
-    return Platform::Linux;
-#else
-    return Platform::Unknown;
-#endif
-}
-
-Architecture::Type ZUpdater::detectArchitecture()
-{
-#if defined(Q_PROCESSOR_X86_64) || defined(Q_PROCESSOR_AMD64)
-    return Architecture::x86_64;
-#elif defined(Q_PROCESSOR_ARM_64) || defined(Q_PROCESSOR_AARCH64)
-    return Architecture::ARM64;
-#elif defined(Q_PROCESSOR_ARM)
-    return Architecture::ARM;
-#else
-    return Architecture::Unknown;
-#endif
-}
+void ZUpdater::checkForUpdates() { m_client->checkForUpdates(); }
 
-void ZUpdater::checkForUpdates()
+/**
+ * Offers the update found by the client to the user
+ */
+void ZUpdater::processUpdate(const QVariantMap &downloadProfile)
 {
-    if (m_platform == Platform::Unknown ||
-        m_architecture == Architecture::Unknown) {
-        qWarning() << "Unknown platform or architecture";
-        return;
-    }
-
-    QString updateUrl = QString("https://api.github.com/repos/%1/releases")
-                            .arg(m_repoOwnerSlashName);
-    QNetworkRequest request((QUrl(updateUrl)));
-    request.setHeader(QNetworkRequest::UserAgentHeader, "ZUpdater");
-
-    QNetworkReply *reply = m_networkManager->get(request);
-
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        qDebug() << "Update check reply received";
-        if (reply->error() != QNetworkReply::NoError) {
-            qWarning() << "Failed to fetch updates:" << reply->errorString();
-            reply->deleteLater();
-            return;
-        }
-        QByteArray response = reply->readAll();
-        reply->deleteLater();
-        QJsonDocument jsonDoc = QJsonDocument::fromJson(response);
-        qDebug() << "Received update data:" << jsonDoc;
-        checkUpdatesInternal(jsonDoc);
-    });
-}
+    QVariantMap profile = downloadProfile;
+    profile["body"] = profile.value("body").toString().replace("\n", "<br/>");
 
-void ZUpdater::checkUpdatesInternal(QJsonDocument jsonDoc)
-{
-    if (!jsonDoc.isArray()) {
-        qWarning() << "Invalid response format";
-        return;
-    }
-    QJsonArray releases = jsonDoc.array();
-    if (releases.isEmpty()) {
-        qInfo() << "No releases found";
-        return;
-    }
+    // A group offers the updates of all its members together
+    if (m_group)
+        return m_group->addUpdate(this, profile);
 
-    /*
-      find the latest release & compare versions
-    */
-    QJsonObject latestVersionObj;
-    QString latestVersion;
-    for (const QJsonValue &releaseVal : releases) {
-        if (!releaseVal.isObject())
-            continue;
-        QJsonObject releaseObj = releaseVal.toObject();
-        if (m_skipPrerelease) {
-            if (releaseObj.value("prerelease").toBool())
-                continue;
-        }
-        QString tagName = releaseObj.value("tag_name").toString();
-        if (tagName.isEmpty())
-            continue;
-
-        // Extract version number from tag
-        QRegularExpression re("v?(\\d+(?:\\.\\d+)*)");
-        QRegularExpressionMatch match = re.match(tagName);
-        if (!match.hasMatch())
-            continue;
-        QString version = match.captured(1);
-        if (version.isEmpty())
-            continue;
-
-        if (compareVersions(m_currentVersion, version)) {
-            latestVersionObj = releaseObj;
-            latestVersion = version;
-            qDebug() << "Found newer release version:" << version;
-            break; // Just process the latest release for now
-        }
-    }
+    // Package managers deliver the update themselves on Linux, whatever
+    // the release ships
+    Platform::Type platform = m_client->platform();
+    if (platform == Platform::Linux && m_isPackageManagerManaged)
+        return showPackageManagerManagedUpdateMessage(profile);
 
-    if (latestVersionObj.isEmpty()) {
-        qWarning() << "latestVersionObj is emty";
+    if (!profile.contains("browser_download_url"))
         return;
-    }
 
-    QJsonValue asset = latestVersionObj.value("assets");
-    if (!asset.isArray() || asset.toArray().isEmpty()) {
-        qWarning() << "No assets found for the latest release";
-        return;
-    }
-    QString assetPattern = detectAssetPattern();
-    qDebug() << "Looking for asset matching pattern:" << assetPattern;
-
-    // Linux scenario
-    if (m_platform == Platform::Linux) {
-        if (m_isPackageManagerManaged)
-            return showPackageManagerManagedUpdateMessage(latestVersionObj);
-
-        QJsonObject obj = getMatchingAsset(assetPattern, asset.toArray());
-
-        if (obj.isEmpty()) {
-            qWarning()
-                << "No matching asset found for the platform/architecture";
-            return;
-        }
-        QVariantMap downloadProfile;
-        downloadProfile["body"] =
-            latestVersionObj.value("body").toString().replace("\n", "<br/>");
-        downloadProfile["tag_name"] =
-            latestVersionObj.value("tag_name").toString();
-        downloadProfile["browser_download_url"] =
-            obj.value("browser_download_url").toString();
-        downloadProfile["file_name"] = obj.value("name").toString();
-
-        qDebug() << "Download url:"
-                 << obj.value("browser_download_url").toString();
-
-        return showDownloadMessageBox(downloadProfile);
-    }
+    if (platform == Platform::MacOS && m_isPackageManagerManaged)
+        return showPackageManagerManagedUpdateMessage(profile);
 
-    // Windows and macOS scenario
-    QJsonObject obj = getMatchingAsset(assetPattern, asset.toArray());
-    if (obj.isEmpty()) {
-        qWarning() << "No matching asset found for the platform/architecture";
+    // Keep quiet until the update is ready to install
+    if (m_preStaging) {
+        m_stagingProfile = profile;
+        m_client->stage(profile);
         return;
     }
 
-    if (m_platform == Platform::MacOS && m_isPackageManagerManaged) {
-        return showPackageManagerManagedUpdateMessage(latestVersionObj);
-    }
+    showDownloadMessageBox(profile);
+}
 
-    QVariantMap downloadProfile;
+void ZUpdater::updateStaged(const QVariantMap &downloadProfile,
+                            const QString &filePath)
+{
+    m_stagingProfile.clear();
+    showDownloadMessageBox(downloadProfile, filePath);
+}
 
-    downloadProfile["body"] =
-        latestVersionObj.value("body").toString().replace("\n", "<br/>");
-    downloadProfile["tag_name"] = latestVersionObj.value("tag_name").toString();
-    downloadProfile["browser_download_url"] =
-        obj.value("browser_download_url").toString();
-    downloadProfile["file_name"] = obj.value("name").toString();
+/**
+ * Offers the regular download if the update could not be staged
+ */
+void ZUpdater::stagingFailed(const QString &error)
+{
+    if (m_stagingProfile.isEmpty())
+        return;
 
-    showDownloadMessageBox(downloadProfile);
-    return;
+    qWarning() << "Failed to stage the update:" << error;
+    QVariantMap profile = m_stagingProfile;
+    m_stagingProfile.clear();
+    showDownloadMessageBox(profile);
 }
 
-void ZUpdater::showPackageManagerManagedUpdateMessage(const QJsonObject &obj)
+void ZUpdater::showPackageManagerManagedUpdateMessage(
+    const QVariantMap &downloadProfile)
 {
-    QString changeLog = obj.value("body").toString().replace("\n", "<br/>");
-    QString version = obj.value("tag_name").toString();
-    QString htmlUrl = obj.value("html_url").toString();
+    QString changeLog = downloadProfile.value("body").toString();
+    QString version = downloadProfile.value("tag_name").toString();
+    QString htmlUrl = downloadProfile.value("html_url").toString();
 
     QMessageBox box;
     box.setTextFormat(Qt::RichText);
@@ -256,98 +149,8 @@ void ZUpdater::showPackageManagerManagedUpdateMessage(const QJsonObject &obj)
     return;
 }
 
-QJsonObject ZUpdater::getMatchingAsset(const QString &assetPattern,
-                                       const QJsonArray &assets)
-{
-    for (const QJsonValue &a : assets) {
-        if (!a.isObject())
-            continue;
-        QJsonObject obj = a.toObject();
-        QString name = obj.value("name").toString();
-        if (name.isEmpty())
-            continue;
-
-        QRegularExpression assetRegex(
-            assetPattern, QRegularExpression::CaseInsensitiveOption);
-        if (assetRegex.match(name).hasMatch()) {
-            return obj;
-        }
-    }
-
-    return QJsonObject();
-}
-
-QString ZUpdater::detectAssetPattern()
-{
-    QString pattern;
-
-    if (m_platform == Platform::Windows) {
-        QString arch =
-            (m_architecture == Architecture::x86_64) ? "x86_64" : "arm64";
-        if (m_isPortable) {
-            pattern = QString(".*-Windows_%1\\.portable\\.zip$").arg(arch);
-        } else {
-            pattern = QString(".*-Windows_%1\\.msi$").arg(arch);
-        }
-    } else if (m_platform == Platform::MacOS) {
-        if (m_architecture == Architecture::x86_64) {
-            pattern = ".*-Apple_Intel\\.dmg$";
-        } else if (m_architecture == Architecture::ARM64) {
-            pattern = ".*-Apple_Silicon\\.dmg$";
-        }
-    } else if (m_platform == Platform::Linux) {
-        QString arch =
-            (m_architecture == Architecture::x86_64) ? "x86_64" : "arm64";
-        pattern = QString(".*-Linux_%1\\.appimage$").arg(arch);
-    }
-
-    return pattern;
-}
-
-bool ZUpdater::compareVersions(const QString &currentVersion,
-                               const QString &latestVersion)
-{
-    // Parse version strings into numeric components
-    auto parseVersion = [](const QString &version) -> QVector<int> {
-        QVector<int> components;
-        QStringList parts = version.split('.', Qt::SkipEmptyParts);
-        for (const QString &part : parts) {
-            bool ok;
-            int num = part.toInt(&ok);
-            if (ok) {
-                components.append(num);
-            } else {
-                // If not a number, treat as 0
-                components.append(0);
-            }
-        }
-        return components;
-    };
-
-    QVector<int> current = parseVersion(currentVersion);
-    QVector<int> latest = parseVersion(latestVersion);
-
-    // Pad with zeros to make them equal length
-    int maxSize = qMax(current.size(), latest.size());
-    while (current.size() < maxSize)
-        current.append(0);
-
-    while (latest.size() < maxSize)
-        latest.append(0);
-
-    // Compare component by component (properly handles 1.1.10 vs 1.1.1)
-    for (int i = 0; i < maxSize; ++i) {
-        if (latest[i] > current[i])
-            return true; // Latest is newer
-        else if (latest[i] < current[i])
-            return false; // Current is newer
-        // If equal, continue to next component
-    }
-
-    return false; // Versions are equal
-}
-
-void ZUpdater::showDownloadMessageBox(const QVariantMap &downloadProfile)
+void ZUpdater::showDownloadMessageBox(const QVariantMap &downloadProfile,
+                                      const QString &stagedFile)
 {
     QString changeLog = downloadProfile.value("body").toString();
     QString version = downloadProfile.value("tag_name").toString();
@@ -357,7 +160,10 @@ void ZUpdater::showDownloadMessageBox(const QVariantMap &downloadProfile)
     box.setTextFormat(Qt::RichText);
     box.setIcon(QMessageBox::Information);
 
-    QString text = tr("Would you like to download the update now?");
+    QString text = stagedFile.isEmpty()
+                       ? tr("Would you like to download the update now?")
+                       : tr("The update has been downloaded. Would you like "
+                            "to install it now?");
     text += "<br/><br/>";
 
     QString title = "<h3>" +
@@ -373,23 +179,71 @@ void ZUpdater::showDownloadMessageBox(const QVariantMap &downloadProfile)
     box.setInformativeText(text);
     box.setStandardButtons(QMessageBox::No | QMessageBox::Yes);
     box.setDefaultButton(QMessageBox::Yes);
+
+    // Follow the redirect to the CDN and connect to it while the user reads
+    // the change log, the download can then start streaming right away
+    if (stagedFile.isEmpty())
+        m_client->networkContext()->prewarm(QUrl(url));
+
     if (box.exec() == QMessageBox::Yes) {
-        download(downloadProfile);
+        if (stagedFile.isEmpty())
+            download(downloadProfile);
+        else
+            install(downloadProfile, stagedFile);
     }
 }
 
 void ZUpdater::download(const QVariantMap &downloadProfile)
 {
-    QString name = downloadProfile.value("file_name").toString();
     QString url = downloadProfile.value("browser_download_url").toString();
 
-    ZDownloader *downloader = new ZDownloader(m_updateProcedure);
-
-    downloader->setFileName(name);
+    ZDownloader *downloader = createDownloader(downloadProfile);
     downloader->show();
     downloader->startDownload(url);
 }
 
+/**
+ * Installs the staged update \a filePath, nothing is downloaded
+ */
+void ZUpdater::install(const QVariantMap &downloadProfile,
+                       const QString &filePath)
+{
+    QString url = downloadProfile.value("browser_download_url").toString();
+
+    ZDownloader *downloader = createDownloader(downloadProfile);
+    downloader->installDownload(url, filePath);
+}
+
+ZDownloader *ZUpdater::createDownloader(const QVariantMap &downloadProfile)
+{
+    QString name = downloadProfile.value("file_name").toString();
+
+    ZDownloader *downloader =
+        new ZDownloader(m_updateProcedure, m_client->networkContext());
+
+    downloader->setFileName(name);
+    downloader->setSegmentCount(m_client->downloadSegmentCount());
+    downloader->setRateLimit(m_client->downloadRateLimit());
+    downloader->setBackgroundMode(m_client->isBackgroundDownload());
+    downloader->setWriteStrategy(m_client->writeStrategy());
+    downloader->setMetricsEnabled(m_client->isMetricsEnabled());
+    downloader->setMetricsFile(m_client->metricsFile());
+    connect(downloader, &ZDownloader::metrics, this, &ZUpdater::metrics);
+    downloader->setExpectedHash(
+        downloadProfile.value("sha256").toString().toUtf8());
+    downloader->setChecksumsUrl(
+        QUrl(downloadProfile.value("checksums_url").toString()));
+    downloader->setBlockIndex(
+        QUrl(downloadProfile.value("zsync_url").toString()),
+        downloadProfile.value("seed_file").toString(),
+        QUrl(downloadProfile.value("zsync_file_url").toString()));
+    downloader->setDelta(QUrl(downloadProfile.value("delta_url").toString()),
+                         downloadProfile.value("base_file").toString());
+    downloader->setCompression(ZContentDecoder::fromName(
+        downloadProfile.value("encoding").toString().toLatin1()));
+    return downloader;
+}
+
 void ZUpdater::setPackageManagerManagedMessage(const QString &msg)
 {
     m_packageManagerManagedMsg = msg;
@@ -21,21 +21,23 @@
  */
 
 #include "ZDownloader.h"
-#include <QtConcurrent>
+#include "ZUpdateClient.h"
 #include <QtCore>
 #include <QtNetwork>
 
-struct Platform {
-    enum Type { Windows, MacOS, Linux, Unknown };
-};
-
-struct Architecture {
-    enum Type { x86_64, ARM64, ARM, Unknown };
-};
+/**
+ * Dialog front end of ZUpdateClient: checks for updates, asks the user
+ * whether to download them and shows the download in a ZDownloader.
+ */
+class ZUpdaterGroup;
 
 class ZUpdater : public QObject
 {
     Q_OBJECT
+
+signals:
+    void metrics(const ZMetrics &metrics);
+
 public:
     ZUpdater(const QString &repoOwnerSlashName, const QString &currentVersion,
              const QString &applicationName, UpdateProcedure updateProcedure,
@@ -45,6 +47,9 @@ public:
 
     void checkForUpdates();
 
+    // The headless updater behind the dialogs
+    ZUpdateClient *client() const { return m_client; }
+
     // Message customization methods
     void setUpdateAvailableMessage(const QString &msg);
     void setNoUpdateMessage(const QString &msg);
@@ -53,37 +58,114 @@ public:
     void setDownloadPromptMessage(const QString &msg);
     void setPackageManagerManagedMessage(const QString &msg);
 
+    // Release check cache
+    void setCacheTtl(int seconds) { m_client->setCacheTtl(seconds); }
+    void setCacheDir(const QString &dir) { m_client->setCacheDir(dir); }
+
+    // Number of concurrent connections used to download the update
+    void setDownloadSegmentCount(int count)
+    {
+        m_client->setDownloadSegmentCount(count);
+    }
+
+    // Bandwidth used by downloads, in bytes per second (0 for no limit), and
+    // whether they back off when the link gets congested
+    void setDownloadRateLimit(qint64 bytesPerSecond)
+    {
+        m_client->setDownloadRateLimit(bytesPerSecond);
+    }
+    void setBackgroundDownload(bool background)
+    {
+        m_client->setBackgroundDownload(background);
+    }
+
+    // Pre-staging: a new release is downloaded in the background first and
+    // only offered once it is ready, so accepting it installs it right away
+    bool isPreStaging() const { return m_preStaging; }
+    void setPreStaging(bool enabled) { m_preStaging = enabled; }
+    void setStagingDir(const QString &dir) { m_client->setStagingDir(dir); }
+    void setStagingSizeLimit(qint64 bytes)
+    {
+        m_client->setStagingSizeLimit(bytes);
+    }
+
+    // How downloads are written to disk
+    void setWriteStrategy(const ZWriteStrategy &strategy)
+    {
+        m_client->setWriteStrategy(strategy);
+    }
+
+    // Timing breakdown of every check and download, emitted through
+    // metrics() and appended as JSON lines to the metrics file if one is set
+    void setMetricsEnabled(bool enabled)
+    {
+        m_client->setMetricsEnabled(enabled);
+    }
+    void setMetricsFile(const QString &path)
+    {
+        m_client->setMetricsFile(path);
+    }
+
+    // Installed copy of the application that delta updates are applied to,
+    // the running AppImage by default
+    QString installedFile() const { return m_client->installedFile(); }
+    void setInstalledFile(const QString &path)
+    {
+        m_client->setInstalledFile(path);
+    }
+
+    // Network stack used for checks and downloads, shared by default
+    ZNetworkContext *networkContext() const
+    {
+        return m_client->networkContext();
+    }
+    void setNetworkContext(ZNetworkContext *network)
+    {
+        m_client->setNetworkContext(network);
+    }
+
     // Platform/Architecture info getters
-    Platform::Type platform() const { return m_platform; }
-    Architecture::Type architecture() const { return m_architecture; }
-    bool isPortable() const { return m_isPortable; }
+    Platform::Type platform() const { return m_client->platform(); }
+    Architecture::Type architecture() const
+    {
+        return m_client->architecture();
+    }
+    bool isPortable() const { return m_client->isPortable(); }
     bool isPackageManagerManaged() const { return m_isPackageManagerManaged; }
-    static Platform::Type detectPlatform();
-    static Architecture::Type detectArchitecture();
+    static Platform::Type detectPlatform()
+    {
+        return ZUpdateClient::detectPlatform();
+    }
+    static Architecture::Type detectArchitecture()
+    {
+        return ZUpdateClient::detectArchitecture();
+    }
+
+private slots:
+    void processUpdate(const QVariantMap &downloadProfile);
+    void updateStaged(const QVariantMap &downloadProfile,
+                      const QString &filePath);
+    void stagingFailed(const QString &error);
 
 private:
-    bool compareVersions(const QString &currentVersion,
-                         const QString &latestVersion);
-    void showDownloadMessageBox(const QVariantMap &downloadProfile);
+    friend class ZUpdaterGroup;
+
+    void showDownloadMessageBox(const QVariantMap &downloadProfile,
+                                const QString &stagedFile = QString());
     void download(const QVariantMap &downloadProfile);
-    void showPackageManagerManagedUpdateMessage(const QJsonObject &obj);
-    QJsonObject getMatchingAsset(const QString &assetPattern,
-                                 const QJsonArray &assets);
-    QString detectAssetPattern();
-    void checkUpdatesInternal(QJsonDocument jsonDoc);
-
-    QString m_repoOwnerSlashName;
-    QString m_currentVersion;
+    void install(const QVariantMap &downloadProfile, const QString &filePath);
+    ZDownloader *createDownloader(const QVariantMap &downloadProfile);
+    void showPackageManagerManagedUpdateMessage(
+        const QVariantMap &downloadProfile);
+
+    ZUpdateClient *m_client;
     QString m_applicationName;
-    bool m_isPortable;
     bool m_isPackageManagerManaged;
-    bool m_skipPrerelease;
     UpdateProcedure m_updateProcedure;
 
-    Platform::Type m_platform;
-    Architecture::Type m_architecture;
-
-    QNetworkAccessManager *m_networkManager;
+    QPointer<ZUpdaterGroup> m_group;
+    bool m_preStaging = false;
+    QVariantMap m_stagingProfile;
 
     // Customizable messages
     QString m_updateAvailableMsg;
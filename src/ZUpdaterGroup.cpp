@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZUpdaterGroup.h"
+#include "ZDownloadQueue.h"
+#include "ZDownloader.h"
+#include "ZUpdater.h"
+#include <QDebug>
+#include <QMessageBox>
+
+ZUpdaterGroup::ZUpdaterGroup(QObject *parent)
+    : QObject(parent), m_maxConcurrentChecks(DefaultMaxConcurrentChecks),
+      m_checking(false), m_running(0)
+{
+}
+
+ZUpdaterGroup::~ZUpdaterGroup()
+{
+    for (const QPointer<ZUpdater> &updater : std::as_const(m_updaters)) {
+        if (updater)
+            updater->m_group = nullptr;
+    }
+}
+
+/**
+ * Adds \a updater to the group. Its updates are offered by the group from
+ * now on.
+ */
+void ZUpdaterGroup::addUpdater(ZUpdater *updater)
+{
+    if (!updater || m_updaters.contains(updater))
+        return;
+
+    m_updaters.append(updater);
+    updater->m_group = this;
+
+    // The updater handles updateAvailable() first and reports the update
+    // through addUpdate(), so every outcome of a check ends up here after it
+    ZUpdateClient *client = updater->client();
+    connect(client, &ZUpdateClient::updateAvailable, this,
+            &ZUpdaterGroup::checkDone);
+    connect(client, &ZUpdateClient::noUpdateAvailable, this,
+            &ZUpdaterGroup::checkDone);
+    connect(client, &ZUpdateClient::checkFailed, this,
+            &ZUpdaterGroup::checkDone);
+}
+
+QList<ZUpdater *> ZUpdaterGroup::updaters() const
+{
+    QList<ZUpdater *> list;
+    for (const QPointer<ZUpdater> &updater : m_updaters) {
+        if (updater)
+            list.append(updater);
+    }
+
+    return list;
+}
+
+void ZUpdaterGroup::setMaxConcurrentChecks(int count)
+{
+    m_maxConcurrentChecks = qMax(1, count);
+}
+
+/**
+ * Checks every repository of the group for updates. Nothing happens if a
+ * check is already running.
+ */
+void ZUpdaterGroup::checkForUpdates()
+{
+    if (isChecking())
+        return;
+
+    m_checking = true;
+    m_updates.clear();
+    m_pending = m_updaters;
+    m_clock.start();
+    startChecks();
+}
+
+/**
+ * Starts checks until the concurrency limit is reached, and completes the
+ * group check once every check has finished
+ */
+void ZUpdaterGroup::startChecks()
+{
+    while (m_running < m_maxConcurrentChecks && !m_pending.isEmpty()) {
+        QPointer<ZUpdater> updater = m_pending.takeFirst();
+        if (!updater)
+            continue;
+
+        ++m_running;
+        updater->client()->checkForUpdates();
+    }
+
+    if (!m_checking || m_running > 0 || !m_pending.isEmpty())
+        return;
+
+    m_checking = false;
+
+    qDebug() << "ZUpdaterGroup: checked" << m_updaters.size()
+             << "repositories in" << m_clock.elapsed() << "ms,"
+             << m_updates.size() << "update(s) found";
+
+    emit checkFinished(m_updates.size());
+    if (!m_updates.isEmpty())
+        showUpdatesMessageBox();
+}
+
+void ZUpdaterGroup::checkDone()
+{
+    if (m_running == 0)
+        return;
+
+    --m_running;
+    startChecks();
+}
+
+void ZUpdaterGroup::addUpdate(ZUpdater *updater,
+                              const QVariantMap &downloadProfile)
+{
+    m_updates.append({updater, downloadProfile});
+}
+
+/**
+ * Returns true if the update can be downloaded, the same rules apply as for
+ * a single ZUpdater
+ */
+bool ZUpdaterGroup::isDownloadable(const Update &update) const
+{
+    if (!update.updater ||
+        !update.downloadProfile.contains("browser_download_url"))
+        return false;
+
+    Platform::Type platform = update.updater->platform();
+    return !update.updater->isPackageManagerManaged() ||
+           (platform != Platform::Linux && platform != Platform::MacOS);
+}
+
+/**
+ * Lists every update that was found and downloads the ones the user accepts
+ */
+void ZUpdaterGroup::showUpdatesMessageBox()
+{
+    QString text;
+    QList<Update> downloadable;
+    for (const Update &update : std::as_const(m_updates)) {
+        if (!update.updater)
+            continue;
+
+        QString changeLog = update.downloadProfile.value("body").toString();
+        QString version = update.downloadProfile.value("tag_name").toString();
+
+        text += "<strong>" + update.updater->m_applicationName + " " +
+                version + "</strong><br/>";
+
+        if (isDownloadable(update))
+            downloadable.append(update);
+        else if (update.updater->isPackageManagerManaged())
+            text += update.updater->m_packageManagerManagedMsg + "<br/>";
+        else
+            text += tr("No download is available for this platform.") +
+                    "<br/>";
+
+        if (!changeLog.isEmpty())
+            text += changeLog + "<br/>";
+        text += "<br/>";
+    }
+
+    QMessageBox box;
+    box.setTextFormat(Qt::RichText);
+    box.setIcon(QMessageBox::Information);
+    box.setText("<h3>" +
+                tr("%n update(s) available", nullptr, int(m_updates.size())) +
+                "</h3>");
+
+    if (downloadable.isEmpty()) {
+        box.setInformativeText(text);
+        box.setStandardButtons(QMessageBox::Ok);
+        box.exec();
+        return;
+    }
+
+    text += tr("Would you like to download the updates now?");
+    box.setInformativeText(text);
+    box.setStandardButtons(QMessageBox::No | QMessageBox::Yes);
+    box.setDefaultButton(QMessageBox::Yes);
+
+    if (box.exec() == QMessageBox::Yes)
+        downloadUpdates(downloadable);
+}
+
+/**
+ * Downloads the accepted \a updates through one queue, with their progress
+ * in the dialog of the last one, the application. Its update is queued first,
+ * which makes it the one the dialog installs.
+ */
+void ZUpdaterGroup::downloadUpdates(const QList<Update> &updates)
+{
+    const Update &application = updates.last();
+    ZDownloader *downloader =
+        application.updater->createDownloader(application.downloadProfile);
+
+    ZDownloadQueue *queue = new ZDownloadQueue(
+        application.updater->client()->networkContext(), downloader);
+    queue->setRateLimit(downloader->rateLimit());
+    queue->setWriteStrategy(downloader->writeStrategy());
+
+    QString dir = downloader->downloadDir();
+    queue->add(application.downloadProfile, dir);
+
+    QMap<int, Update> others;
+    for (int i = 0; i < updates.size() - 1; ++i)
+        others.insert(queue->add(updates[i].downloadProfile, dir), updates[i]);
+
+    // Connected before the dialog is, so the other updates are installed
+    // before the dialog installs the application
+    connect(queue, &ZDownloadQueue::finished, this,
+            [this, queue, others]() { installUpdates(queue, others); });
+
+    downloader->show();
+    downloader->startDownloads(queue);
+}
+
+/**
+ * Installs the downloaded \a updates other than the application, in the
+ * order they were added. Nothing is installed if a download failed, the
+ * dialog shows the error.
+ */
+void ZUpdaterGroup::installUpdates(ZDownloadQueue *queue,
+                                   const QMap<int, Update> &updates)
+{
+    if (queue->failedCount() > 0)
+        return;
+
+    for (auto it = updates.cbegin(); it != updates.cend(); ++it) {
+        if (it.value().updater)
+            it.value().updater->install(it.value().downloadProfile,
+                                        queue->filePath(it.key()));
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZUPDATER_GROUP_H
+#define ZUPDATER_GROUP_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QVariantMap>
+
+class ZUpdater;
+class ZDownloadQueue;
+
+/**
+ * Checks several repositories at once, e.g. an application and its plugins,
+ * and offers all their updates in a single prompt.
+ *
+ * The checks run concurrently, at most maxConcurrentChecks() at a time. They
+ * go through the shared network context, so requests to the GitHub API are
+ * multiplexed over a single HTTP/2 connection, and each repository keeps its
+ * own release cache. Once every check has finished, the updates that were
+ * found are listed together. Accepted updates are downloaded together
+ * through one ZDownloadQueue, with the rate limit and write strategy of the
+ * last updater, and their progress is shown as one in a single dialog. Group
+ * downloads fetch the full assets, without block reuse or delta patches.
+ * Once all of them have been downloaded, they are installed in the order the
+ * updaters were added: add the application itself last, its installer may
+ * quit it.
+ *
+ * The updaters keep their settings, but don't show prompts of their own
+ * while they belong to a group.
+ */
+class ZUpdaterGroup : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void checkFinished(int updatesFound);
+
+public:
+    static constexpr int DefaultMaxConcurrentChecks = 8;
+
+    explicit ZUpdaterGroup(QObject *parent = nullptr);
+    ~ZUpdaterGroup();
+
+    void addUpdater(ZUpdater *updater);
+    QList<ZUpdater *> updaters() const;
+
+    int maxConcurrentChecks() const { return m_maxConcurrentChecks; }
+    void setMaxConcurrentChecks(int count);
+
+    void checkForUpdates();
+    bool isChecking() const { return m_checking; }
+
+private slots:
+    void checkDone();
+
+private:
+    friend class ZUpdater;
+
+    struct Update {
+        QPointer<ZUpdater> updater;
+        QVariantMap downloadProfile;
+    };
+
+    void startChecks();
+    void addUpdate(ZUpdater *updater, const QVariantMap &downloadProfile);
+    bool isDownloadable(const Update &update) const;
+    void showUpdatesMessageBox();
+    void downloadUpdates(const QList<Update> &updates);
+    void installUpdates(ZDownloadQueue *queue,
+                        const QMap<int, Update> &updates);
+
+    QList<QPointer<ZUpdater>> m_updaters;
+    int m_maxConcurrentChecks;
+
+    // Current check
+    bool m_checking;
+    QList<QPointer<ZUpdater>> m_pending;
+    int m_running;
+    QElapsedTimer m_clock;
+    QList<Update> m_updates;
+};
+
+#endif
@@ -0,0 +1,452 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ZVERSION_H
+#define ZVERSION_H
+
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * A parsed version number with SemVer precedence.
+ *
+ * Anything before the first digit (a "v" or "release-" prefix) is ignored,
+ * numeric components are compared in order and missing components count as
+ * zero, so 1.2 equals 1.2.0. A pre-release part ("-rc.1", or a suffix such
+ * as "rc1" directly after the numbers) makes the version lower than the same
+ * version without one. Build metadata after "+" is ignored.
+ *
+ * Up to MaxComponents components and MaxIdentifiers pre-release identifiers
+ * are packed inline. Each identifier becomes a 64 bit integer whose natural
+ * order is the SemVer order: numeric identifiers compare by value and below
+ * alphanumeric ones, which compare by their first 7 ASCII characters. Typical
+ * versions therefore parse and compare without allocating, and literals can
+ * be parsed at compile time.
+ *
+ * A version that does not fit, e.g. 1.2.3.4.5 or 1.0.0-prerelease1, keeps
+ * its text instead and is compared by walking both texts. Texts parsed at
+ * runtime are interned for the life of the process, a literal must outlive
+ * the version like any string literal does.
+ */
+class ZVersion
+{
+public:
+    static constexpr int MaxComponents = 4;
+    static constexpr int MaxIdentifiers = 4;
+
+    constexpr ZVersion() = default;
+    constexpr explicit ZVersion(const char *version)
+        : ZVersion(parse(version, length(version)))
+    {
+        if (m_truncated)
+            m_latin1 = version;
+    }
+
+    static ZVersion fromString(const QString &version)
+    {
+        ZVersion v = parse(version.utf16(), version.size());
+        if (v.m_truncated)
+            v.m_utf16 = intern(version);
+        return v;
+    }
+
+    constexpr bool isValid() const { return m_valid; }
+    constexpr bool isPrerelease() const
+    {
+        return m_identifiers[0] != ReleaseMark;
+    }
+
+    /**
+     * Returns a negative number, zero or a positive number if this version
+     * is lower than, equal to or higher than \a other
+     */
+    constexpr int compare(const ZVersion &other) const
+    {
+        if (m_truncated || other.m_truncated)
+            return compareText(other);
+
+        for (int i = 0; i < MaxComponents; ++i) {
+            if (m_components[i] != other.m_components[i])
+                return m_components[i] < other.m_components[i] ? -1 : 1;
+        }
+        for (int i = 0; i < MaxIdentifiers; ++i) {
+            if (m_identifiers[i] != other.m_identifiers[i])
+                return m_identifiers[i] < other.m_identifiers[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    friend constexpr bool operator==(const ZVersion &a, const ZVersion &b)
+    {
+        return a.compare(b) == 0;
+    }
+    friend constexpr bool operator!=(const ZVersion &a, const ZVersion &b)
+    {
+        return a.compare(b) != 0;
+    }
+    friend constexpr bool operator<(const ZVersion &a, const ZVersion &b)
+    {
+        return a.compare(b) < 0;
+    }
+    friend constexpr bool operator<=(const ZVersion &a, const ZVersion &b)
+    {
+        return a.compare(b) <= 0;
+    }
+    friend constexpr bool operator>(const ZVersion &a, const ZVersion &b)
+    {
+        return a.compare(b) > 0;
+    }
+    friend constexpr bool operator>=(const ZVersion &a, const ZVersion &b)
+    {
+        return a.compare(b) >= 0;
+    }
+
+private:
+    // A version without pre-release sorts above every identifier
+    static constexpr quint64 ReleaseMark = ~quint64(0);
+    static constexpr quint64 AlphaMark = quint64(1) << 63;
+    static constexpr quint64 MaxNumber = (quint64(1) << 62) - 1;
+    static constexpr quint64 MaxComponent = 0xffffffff;
+    static constexpr int PackedChars = 7;
+
+    // Longest text of a packed version: 4 components of 10 digits, 4
+    // identifiers of 19 digits, and the separators
+    static constexpr int TextSize = 128;
+
+    template <typename Char> static constexpr bool isDigit(Char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    static constexpr qsizetype length(const char *s)
+    {
+        qsizetype n = 0;
+        while (s[n])
+            ++n;
+        return n;
+    }
+
+    static const char16_t *intern(const QString &version)
+    {
+        static QMutex mutex;
+        static QSet<QString> texts;
+
+        QMutexLocker locker(&mutex);
+        return QStringView(*texts.insert(version)).utf16();
+    }
+
+    template <typename Char>
+    static constexpr quint64 number(const Char *s, qsizetype &i,
+                                    qsizetype size)
+    {
+        quint64 n = 0;
+        for (; i < size && isDigit(s[i]); ++i)
+            n = n > MaxNumber / 10 ? MaxNumber : n * 10 + quint64(s[i] - '0');
+        return n;
+    }
+
+    // Moves past the dot to the next component, if there is one
+    template <typename Char>
+    static constexpr bool nextComponent(const Char *s, qsizetype &i,
+                                        qsizetype size)
+    {
+        if (i + 1 < size && s[i] == '.' && isDigit(s[i + 1])) {
+            ++i;
+            return true;
+        }
+        return false;
+    }
+
+    // Finds the next non-empty pre-release identifier in [begin, end)
+    template <typename Char>
+    static constexpr bool nextIdentifier(const Char *s, qsizetype &i,
+                                         qsizetype size, qsizetype &begin,
+                                         qsizetype &end)
+    {
+        while (i < size && s[i] != '+') {
+            begin = i;
+            while (i < size && s[i] != '.' && s[i] != '+')
+                ++i;
+            end = i;
+
+            if (i < size && s[i] == '.')
+                ++i;
+            if (end > begin)
+                return true;
+        }
+        return false;
+    }
+
+    template <typename Char>
+    static constexpr bool isNumeric(const Char *s, qsizetype begin,
+                                    qsizetype end)
+    {
+        for (qsizetype i = begin; i < end; ++i) {
+            if (!isDigit(s[i]))
+                return false;
+        }
+        return true;
+    }
+
+    template <typename Char>
+    static constexpr ZVersion parse(const Char *s, qsizetype size)
+    {
+        ZVersion v;
+        qsizetype i = 0;
+
+        while (i < size && !isDigit(s[i]))
+            ++i;
+
+        for (int c = 0; i < size && isDigit(s[i]); ++c) {
+            quint64 n = number(s, i, size);
+            if (c < MaxComponents)
+                v.m_components[c] = quint32(qMin(n, MaxComponent));
+            else
+                v.m_truncated = true;
+            v.m_valid = true;
+
+            if (!nextComponent(s, i, size))
+                break;
+        }
+
+        if (i < size && (s[i] == '-' || s[i] == '.'))
+            ++i;
+
+        int count = 0;
+        qsizetype begin = 0;
+        qsizetype end = 0;
+        while (nextIdentifier(s, i, size, begin, end)) {
+            if (count == MaxIdentifiers) {
+                v.m_truncated = true;
+                break;
+            }
+
+            quint64 packed = 0;
+            if (isNumeric(s, begin, end)) {
+                packed = number(s, begin, end) + 1;
+            } else {
+                packed = AlphaMark;
+                for (int k = 0; k < PackedChars && begin + k < end; ++k) {
+                    quint64 ch = quint64(s[begin + k]) & 0x7f;
+                    packed |= ch << (8 * (PackedChars - 1 - k));
+                }
+                if (end - begin > PackedChars)
+                    v.m_truncated = true;
+            }
+            v.m_identifiers[count++] = packed;
+        }
+
+        if (count == 0)
+            v.m_identifiers[0] = ReleaseMark;
+        if (v.m_truncated)
+            v.m_size = size;
+
+        return v;
+    }
+
+    static constexpr qsizetype appendNumber(char *text, qsizetype n,
+                                            quint64 value)
+    {
+        char digits[20] = {};
+        int count = 0;
+        do {
+            digits[count++] = char('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+
+        while (count > 0)
+            text[n++] = digits[--count];
+        return n;
+    }
+
+    // Writes the text of a packed version, which parses back to it
+    constexpr qsizetype format(char *text) const
+    {
+        qsizetype n = 0;
+        for (int i = 0; i < MaxComponents; ++i) {
+            if (i > 0)
+                text[n++] = '.';
+            n = appendNumber(text, n, m_components[i]);
+        }
+
+        for (int i = 0; i < MaxIdentifiers; ++i) {
+            quint64 packed = m_identifiers[i];
+            if (packed == 0 || packed == ReleaseMark)
+                break;
+
+            text[n++] = i == 0 ? '-' : '.';
+            if (!(packed & AlphaMark)) {
+                n = appendNumber(text, n, packed - 1);
+                continue;
+            }
+            for (int k = 0; k < PackedChars; ++k) {
+                char ch = char((packed >> (8 * (PackedChars - 1 - k))) & 0x7f);
+                if (!ch)
+                    break;
+                text[n++] = ch;
+            }
+        }
+
+        return n;
+    }
+
+    template <typename A, typename B>
+    static constexpr int compareIdentifiers(const A *a, qsizetype aBegin,
+                                            qsizetype aEnd, const B *b,
+                                            qsizetype bBegin, qsizetype bEnd)
+    {
+        bool aNumeric = isNumeric(a, aBegin, aEnd);
+        bool bNumeric = isNumeric(b, bBegin, bEnd);
+        if (aNumeric != bNumeric)
+            return aNumeric ? -1 : 1;
+
+        if (aNumeric) {
+            quint64 x = number(a, aBegin, aEnd);
+            quint64 y = number(b, bBegin, bEnd);
+            return x == y ? 0 : (x < y ? -1 : 1);
+        }
+
+        for (; aBegin < aEnd && bBegin < bEnd; ++aBegin, ++bBegin) {
+            quint64 x = quint64(a[aBegin]) & 0x7f;
+            quint64 y = quint64(b[bBegin]) & 0x7f;
+            if (x != y)
+                return x < y ? -1 : 1;
+        }
+        if (aBegin < aEnd)
+            return 1;
+        return bBegin < bEnd ? -1 : 0;
+    }
+
+    // Same precedence as the packed values, without their limits
+    template <typename A, typename B>
+    static constexpr int compareText(const A *a, qsizetype aSize, const B *b,
+                                     qsizetype bSize)
+    {
+        qsizetype i = 0;
+        qsizetype j = 0;
+        while (i < aSize && !isDigit(a[i]))
+            ++i;
+        while (j < bSize && !isDigit(b[j]))
+            ++j;
+
+        bool aMore = i < aSize && isDigit(a[i]);
+        bool bMore = j < bSize && isDigit(b[j]);
+        while (aMore || bMore) {
+            quint64 x = aMore ? qMin(number(a, i, aSize), MaxComponent) : 0;
+            quint64 y = bMore ? qMin(number(b, j, bSize), MaxComponent) : 0;
+            if (x != y)
+                return x < y ? -1 : 1;
+
+            aMore = aMore && nextComponent(a, i, aSize);
+            bMore = bMore && nextComponent(b, j, bSize);
+        }
+
+        if (i < aSize && (a[i] == '-' || a[i] == '.'))
+            ++i;
+        if (j < bSize && (b[j] == '-' || b[j] == '.'))
+            ++j;
+
+        for (int k = 0;; ++k) {
+            qsizetype aBegin = 0, aEnd = 0, bBegin = 0, bEnd = 0;
+            bool aHas = nextIdentifier(a, i, aSize, aBegin, aEnd);
+            bool bHas = nextIdentifier(b, j, bSize, bBegin, bEnd);
+            if (!aHas || !bHas) {
+                if (aHas == bHas)
+                    return 0;
+                // No identifier at all is a release, above its pre-releases.
+                // After that, the shorter list of identifiers is the lower.
+                return (k == 0) != aHas ? 1 : -1;
+            }
+
+            int c = compareIdentifiers(a, aBegin, aEnd, b, bBegin, bEnd);
+            if (c != 0)
+                return c;
+        }
+    }
+
+    constexpr int compareText(const ZVersion &other) const
+    {
+        char text[TextSize] = {};
+        char otherText[TextSize] = {};
+        qsizetype size = m_truncated ? m_size : format(text);
+        qsizetype otherSize = other.m_truncated ? other.m_size
+                                                : other.format(otherText);
+
+        const char *latin1 = m_truncated ? m_latin1 : text;
+        const char *otherLatin1 =
+            other.m_truncated ? other.m_latin1 : otherText;
+
+        if (m_utf16 && other.m_utf16)
+            return compareText(m_utf16, size, other.m_utf16, otherSize);
+        if (m_utf16)
+            return compareText(m_utf16, size, otherLatin1, otherSize);
+        if (other.m_utf16)
+            return compareText(latin1, size, other.m_utf16, otherSize);
+        return compareText(latin1, size, otherLatin1, otherSize);
+    }
+
+    quint32 m_components[MaxComponents] = {};
+    quint64 m_identifiers[MaxIdentifiers] = {};
+    bool m_valid = false;
+
+    // The text of a version that does not fit the packed form
+    bool m_truncated = false;
+    const char *m_latin1 = nullptr;
+    const char16_t *m_utf16 = nullptr;
+    qsizetype m_size = 0;
+};
+
+// SemVer 2.0.0 precedence, the example of section 11
+static_assert(ZVersion("1.0.0-alpha") < ZVersion("1.0.0-alpha.1"));
+static_assert(ZVersion("1.0.0-alpha.1") < ZVersion("1.0.0-alpha.beta"));
+static_assert(ZVersion("1.0.0-alpha.beta") < ZVersion("1.0.0-beta"));
+static_assert(ZVersion("1.0.0-beta") < ZVersion("1.0.0-beta.2"));
+static_assert(ZVersion("1.0.0-beta.2") < ZVersion("1.0.0-beta.11"));
+static_assert(ZVersion("1.0.0-beta.11") < ZVersion("1.0.0-rc.1"));
+static_assert(ZVersion("1.0.0-rc.1") < ZVersion("1.0.0"));
+static_assert(ZVersion("1.0.0") < ZVersion("2.0.0-alpha"));
+static_assert(ZVersion("1.0.0+build.5") == ZVersion("1.0.0"));
+static_assert(ZVersion("1.2.0-rc1") < ZVersion("1.2.0"));
+static_assert(ZVersion("1.2.0-rc1").isPrerelease());
+
+// Release tags compare as they did with the old compareVersions()
+static_assert(ZVersion("1.1.10") > ZVersion("1.1.9"));
+static_assert(ZVersion("v1.2") == ZVersion("1.2.0"));
+static_assert(ZVersion("v1.2.3") == ZVersion("1.2.3"));
+static_assert(ZVersion("release-2.0") > ZVersion("v1.99.99"));
+static_assert(ZVersion("1.2.3.1") > ZVersion("1.2.3"));
+static_assert(ZVersion("10.0") > ZVersion("9.9.9"));
+static_assert(!ZVersion("latest").isValid());
+
+// Versions beyond the packed capacity are compared in full
+static_assert(ZVersion("1.2.3.4.5") < ZVersion("1.2.3.4.6"));
+static_assert(ZVersion("1.2.3.4.0") == ZVersion("1.2.3.4"));
+static_assert(ZVersion("1.2.3.5") > ZVersion("1.2.3.4.9"));
+static_assert(ZVersion("1.0.0-prerelease1") < ZVersion("1.0.0-prerelease2"));
+static_assert(ZVersion("1.0.0-prerelease") < ZVersion("1.0.0-prerelease1"));
+static_assert(ZVersion("1.0.0-a.b.c.d") < ZVersion("1.0.0-a.b.c.d.e"));
+static_assert(ZVersion("1.0.0-a.b.c.d.1") < ZVersion("1.0.0-a.b.c.d.e"));
+static_assert(ZVersion("1.0.0-prerelease1") < ZVersion("1.0.0"));
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZStagingArea.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+class tst_ZStagingArea : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void stagedFile_data();
+    void stagedFile();
+};
+
+static const QByteArray CONTENT = "staged update";
+
+void tst_ZStagingArea::stagedFile_data()
+{
+    QTest::addColumn<QString>("sha256");
+    QTest::addColumn<QByteArray>("reused");
+    QTest::addColumn<bool>("accepted");
+
+    const QString hash = QString::fromLatin1(
+        QCryptographicHash::hash(CONTENT, QCryptographicHash::Sha256)
+            .toHex());
+    const QByteArray tampered = "Staged update";
+
+    QTest::newRow("sha256") << hash << CONTENT << true;
+    QTest::newRow("sha256, uppercase") << hash.toUpper() << CONTENT << true;
+    QTest::newRow("sha256, changed") << hash << tampered << false;
+    QTest::newRow("checksums file") << QString() << CONTENT << true;
+    QTest::newRow("checksums file, changed")
+        << QString() << tampered << false;
+}
+
+/**
+ * A staged file is only reused while it still has the hash it was staged
+ * with, whether the profile has a SHA-256 or only a checksums file
+ */
+void tst_ZStagingArea::stagedFile()
+{
+    QFETCH(QString, sha256);
+    QFETCH(QByteArray, reused);
+    QFETCH(bool, accepted);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ZStagingArea staging("owner/app");
+    staging.setDir(dir.path());
+
+    QVariantMap profile;
+    profile["tag_name"] = "v2.0.0";
+    profile["browser_download_url"] =
+        "https://github.com/owner/app/releases/download/v2.0.0/App.AppImage";
+    profile["size"] = CONTENT.size();
+    if (sha256.isEmpty())
+        profile["checksums_url"] = "https://example.com/SHA256SUMS";
+    else
+        profile["sha256"] = sha256;
+
+    QString stagingDir = staging.directoryFor(profile);
+    QVERIFY(QDir().mkpath(stagingDir));
+    QString path = QDir(stagingDir).filePath("App.AppImage");
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(CONTENT);
+    file.close();
+    QVERIFY(staging.add(profile, path));
+
+    // Same size, different content
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(reused);
+    file.close();
+
+    QCOMPARE(staging.stagedFile(profile), accepted ? path : QString());
+}
+
+QTEST_GUILESS_MAIN(tst_ZStagingArea)
+#include "tst_ZStagingArea.moc"
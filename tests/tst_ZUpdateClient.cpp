@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZUpdateClient.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTest>
+
+class tst_ZUpdateClient : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void findDelta_data();
+    void findDelta();
+};
+
+static QJsonObject asset(const QString &name)
+{
+    QJsonObject object;
+    object["name"] = name;
+    object["browser_download_url"] =
+        "https://github.com/owner/app/releases/download/v2.1.0/" + name;
+    return object;
+}
+
+void tst_ZUpdateClient::findDelta_data()
+{
+    QTest::addColumn<QString>("asset");
+    QTest::addColumn<QStringList>("assets");
+    QTest::addColumn<QString>("from");
+    QTest::addColumn<QString>("to");
+    QTest::addColumn<QString>("expected");
+
+    const QString appImage = "App-2.1.0-Linux_x86_64.AppImage";
+    const QString msi = "App-2.1.0-Windows_x86_64.msi";
+
+    QTest::newRow("from-to")
+        << appImage
+        << QStringList{appImage, "App-2.0.0_to_2.1.0-Linux_x86_64.patch"}
+        << "2.0.0" << "v2.1.0" << "App-2.0.0_to_2.1.0-Linux_x86_64.patch";
+    QTest::newRow("from-to, other installed version")
+        << appImage
+        << QStringList{appImage, "App-1.9.0_to_2.1.0-Linux_x86_64.patch"}
+        << "2.0.0" << "v2.1.0" << "";
+    QTest::newRow("from-to, other release")
+        << appImage
+        << QStringList{appImage, "App-2.0.0_to_2.0.1-Linux_x86_64.patch"}
+        << "2.0.0" << "v2.1.0" << "";
+    QTest::newRow("from-to, other platform")
+        << appImage
+        << QStringList{appImage, "App-2.0.0_to_2.1.0-Linux_arm64.patch"}
+        << "2.0.0" << "v2.1.0" << "";
+    QTest::newRow("from-to, other app")
+        << appImage
+        << QStringList{appImage, "Plugin-2.0.0_to_2.1.0-Linux_x86_64.patch"}
+        << "2.0.0" << "v2.1.0" << "";
+    QTest::newRow("from-to, pre-releases")
+        << "App-2.1.0-rc1-Linux_x86_64.AppImage"
+        << QStringList{"App-2.0.0-beta.2_to_2.1.0-rc1-Linux_x86_64.patch"}
+        << "2.0.0-beta.2" << "2.1.0-rc1"
+        << "App-2.0.0-beta.2_to_2.1.0-rc1-Linux_x86_64.patch";
+    QTest::newRow("from-to, digits in the app name")
+        << "App2-2.1.0-Windows_x86_64.msi"
+        << QStringList{"App2-2.0.0_to_2.1.0-Windows_x86_64.patch"}
+        << "2.0.0" << "2.1.0" << "App2-2.0.0_to_2.1.0-Windows_x86_64.patch";
+    QTest::newRow("asset from")
+        << msi
+        << QStringList{msi, "App-2.1.0-Windows_x86_64.portable.zip",
+                       "App-2.1.0-Windows_x86_64.portable.zip.from-2.0.0.patch",
+                       msi + ".from-2.0.0.patch"}
+        << "2.0.0" << "2.1.0" << msi + ".from-2.0.0.patch";
+    QTest::newRow("asset from, other installed version")
+        << msi << QStringList{msi, msi + ".from-1.9.0.patch"} << "2.0.0"
+        << "2.1.0" << "";
+    QTest::newRow("not a patch")
+        << appImage
+        << QStringList{appImage, "App-2.0.0_to_2.1.0-Linux_x86_64.zsync"}
+        << "2.0.0" << "2.1.0" << "";
+}
+
+/**
+ * Both patch names are matched against the installed and the new version
+ */
+void tst_ZUpdateClient::findDelta()
+{
+    QFETCH(QString, asset);
+    QFETCH(QStringList, assets);
+    QFETCH(QString, from);
+    QFETCH(QString, to);
+    QFETCH(QString, expected);
+
+    QJsonArray list;
+    for (const QString &name : std::as_const(assets))
+        list.append(::asset(name));
+
+    QJsonObject patch = ZUpdateClient::findDelta(
+        ::asset(asset), list, ZVersion::fromString(from),
+        ZVersion::fromString(to));
+
+    QCOMPARE(patch.value("name").toString(), expected);
+}
+
+QTEST_GUILESS_MAIN(tst_ZUpdateClient)
+#include "tst_ZUpdateClient.moc"
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZReleaseCache.h"
+#include "ZUpdater.h"
+#include "ZUpdaterGroup.h"
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+class tst_ZUpdaterGroup : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void checkAnsweredFromCache_data();
+    void checkAnsweredFromCache();
+};
+
+void tst_ZUpdaterGroup::checkAnsweredFromCache_data()
+{
+    QTest::addColumn<int>("members");
+    QTest::addColumn<int>("maxConcurrentChecks");
+
+    QTest::newRow("one") << 1 << ZUpdaterGroup::DefaultMaxConcurrentChecks;
+    QTest::newRow("below limit")
+        << 3 << ZUpdaterGroup::DefaultMaxConcurrentChecks;
+    QTest::newRow("above limit") << 5 << 2;
+    QTest::newRow("serial") << 4 << 1;
+}
+
+/**
+ * Every member answers from a fresh cache. The answers must still arrive
+ * from the event loop, and the group must report once.
+ */
+void tst_ZUpdaterGroup::checkAnsweredFromCache()
+{
+    QFETCH(int, members);
+    QFETCH(int, maxConcurrentChecks);
+
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+
+    ZUpdaterGroup group;
+    group.setMaxConcurrentChecks(maxConcurrentChecks);
+
+    QList<ZUpdater *> updaters;
+    for (int i = 0; i < members; ++i) {
+        QString repo = QString("owner/repo%1").arg(i);
+
+        // An empty release is the cached answer for "no update"
+        ZReleaseCache cache(repo, "1.0.0", false);
+        cache.setCacheDir(cacheDir.path());
+        cache.setRelease(QJsonObject());
+        QVERIFY(cache.save());
+
+        ZUpdater *updater = new ZUpdater(repo, "1.0.0", repo, {}, false,
+                                         false, false, &group);
+        updater->setCacheDir(cacheDir.path());
+        updater->setCacheTtl(3600);
+        group.addUpdater(updater);
+        updaters.append(updater);
+    }
+
+    QSignalSpy finished(&group, &ZUpdaterGroup::checkFinished);
+    group.checkForUpdates();
+
+    QCOMPARE(finished.count(), 0);
+    QVERIFY(group.isChecking());
+    QVERIFY(finished.wait(5000));
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.first().first().toInt(), 0);
+    QVERIFY(!group.isChecking());
+
+    // Nothing is left over to complete the check a second time
+    QCoreApplication::processEvents();
+    QCOMPARE(finished.count(), 1);
+
+    // And the group can check again
+    group.checkForUpdates();
+    QVERIFY(finished.wait(5000));
+    QCOMPARE(finished.count(), 2);
+    QVERIFY(!group.isChecking());
+}
+
+QTEST_MAIN(tst_ZUpdaterGroup)
+#include "tst_ZUpdaterGroup.moc"
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2025 Uncore <https://github.com/uncor3>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ZVersion.h"
+#include <QList>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTest>
+#include <iterator>
+
+// Pre-release identifiers the generated versions are made of, including
+// ones longer than the packed 7 characters
+static const char *const IDENTIFIERS[] = {
+    "a",           "B",           "alpha",           "beta",
+    "rc",          "x-y",         "prereleas",       "prerelease",
+    "prerelease1", "prerelease2", "nightly20250101", "nightly20250102",
+};
+
+static const int GENERATED_VERSIONS = 1500;
+
+class tst_ZVersion : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void numericMatchesBaseline();
+    void prereleaseMatchesReference();
+};
+
+static int sign(int value) { return (value > 0) - (value < 0); }
+
+/**
+ * The numeric components as the old ZUpdater::compareVersions() saw them
+ */
+static QList<int> baselineComponents(const QString &version)
+{
+    QList<int> components;
+    const QStringList parts = version.split('.', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        bool ok;
+        int num = part.toInt(&ok);
+        components.append(ok ? num : 0);
+    }
+    return components;
+}
+
+/**
+ * ZUpdater::compareVersions(a, b) before ZVersion, as a three-way result
+ */
+static int baselineCompare(const QList<int> &a, const QList<int> &b)
+{
+    // Missing components count as zero
+    for (int i = 0; i < qMax(a.size(), b.size()); ++i) {
+        if (a.value(i) != b.value(i))
+            return a.value(i) < b.value(i) ? -1 : 1;
+    }
+    return 0;
+}
+
+struct Identifier {
+    QString text;
+    bool numeric;
+    quint64 number;
+};
+
+struct Reference {
+    QList<quint64> components;
+    QList<Identifier> identifiers;
+};
+
+static quint64 number(const QString &digits)
+{
+    // Saturates like ZVersion does, far above any real version
+    const quint64 max = (quint64(1) << 62) - 1;
+    quint64 n = 0;
+    for (QChar c : digits)
+        n = n > max / 10 ? max : n * 10 + quint64(c.digitValue());
+    return n;
+}
+
+/**
+ * Splits \a version the way ZVersion documents it, without any limits
+ */
+static Reference reference(const QString &version)
+{
+    static const QRegularExpression re(
+        "^\\D*(\\d+(?:\\.\\d+)*)?[-.]?([^+]*)");
+    static const QRegularExpression digits("^\\d+$");
+    QRegularExpressionMatch match = re.match(version);
+
+    Reference r;
+    const QStringList components =
+        match.captured(1).split('.', Qt::SkipEmptyParts);
+    for (const QString &component : components)
+        r.components.append(qMin<quint64>(number(component), 0xffffffff));
+
+    const QStringList identifiers =
+        match.captured(2).split('.', Qt::SkipEmptyParts);
+    for (const QString &identifier : identifiers) {
+        bool numeric = digits.match(identifier).hasMatch();
+        r.identifiers.append(
+            {identifier, numeric, numeric ? number(identifier) : 0});
+    }
+    return r;
+}
+
+/**
+ * SemVer precedence of two references
+ */
+static int referenceCompare(const Reference &a, const Reference &b)
+{
+    for (int i = 0; i < qMax(a.components.size(), b.components.size());
+         ++i) {
+        if (a.components.value(i) != b.components.value(i))
+            return a.components.value(i) < b.components.value(i) ? -1 : 1;
+    }
+
+    // A release is above all of its pre-releases
+    if (a.identifiers.isEmpty() || b.identifiers.isEmpty())
+        return sign(int(a.identifiers.isEmpty()) -
+                    int(b.identifiers.isEmpty()));
+
+    for (int i = 0; i < a.identifiers.size() && i < b.identifiers.size();
+         ++i) {
+        const Identifier &x = a.identifiers[i];
+        const Identifier &y = b.identifiers[i];
+        if (x.numeric != y.numeric)
+            return x.numeric ? -1 : 1;
+
+        if (x.numeric) {
+            if (x.number != y.number)
+                return x.number < y.number ? -1 : 1;
+        } else if (x.text != y.text) {
+            return x.text < y.text ? -1 : 1;
+        }
+    }
+
+    return sign(int(a.identifiers.size() - b.identifiers.size()));
+}
+
+/**
+ * Every numeric version of 1 to 6 components (more than ZVersion packs)
+ * orders as it did with the old comparator
+ */
+void tst_ZVersion::numericMatchesBaseline()
+{
+    const int values[] = {0, 1, 10};
+
+    QStringList versions;
+    QStringList previous = {QString()};
+    for (int length = 1; length <= 6; ++length) {
+        QStringList current;
+        for (const QString &prefix : std::as_const(previous)) {
+            for (int value : values) {
+                current.append(prefix + (prefix.isEmpty() ? "" : ".") +
+                               QString::number(value));
+            }
+        }
+        versions += current;
+        previous = current;
+    }
+
+    QList<ZVersion> parsed;
+    QList<QList<int>> baseline;
+    for (const QString &version : std::as_const(versions)) {
+        // Tags came with a "v" prefix, which the old tag regex dropped
+        parsed.append(ZVersion::fromString("v" + version));
+        baseline.append(baselineComponents(version));
+    }
+
+    for (int i = 0; i < versions.size(); ++i) {
+        for (int j = 0; j < versions.size(); ++j) {
+            int expected = baselineCompare(baseline[i], baseline[j]);
+            if (sign(parsed[i].compare(parsed[j])) != expected)
+                QFAIL(qPrintable(versions[i] + " vs " + versions[j]));
+        }
+    }
+}
+
+/**
+ * Generated versions with prefixes, pre-releases and build metadata follow
+ * SemVer precedence, whether they fit the packed form or not, parsed from a
+ * QString or from a literal
+ */
+void tst_ZVersion::prereleaseMatchesReference()
+{
+    QRandomGenerator random(12345);
+    const int identifierCount = int(std::size(IDENTIFIERS));
+
+    QStringList versions = {"1.2.3.4.5", "1.2.3.4.6", "1.0.0-a.b.c.d.e",
+                            "4294967295.1", "99999999999.1"};
+    while (versions.size() < GENERATED_VERSIONS) {
+        QString version;
+        int prefix = random.bounded(4);
+        if (prefix == 0)
+            version = "v";
+        else if (prefix == 1)
+            version = "release-";
+
+        int components = 1 + random.bounded(6);
+        for (int i = 0; i < components; ++i) {
+            int value = random.bounded(5);
+            version += (i > 0 ? "." : "") +
+                       QString::number(value == 4 ? 10 : value);
+        }
+
+        int identifiers = random.bounded(3) == 0 ? random.bounded(7) : 0;
+        for (int i = 0; i < identifiers; ++i) {
+            // "1.2rc1" is a pre-release too
+            if (i > 0)
+                version += ".";
+            else if (random.bounded(4) > 0)
+                version += "-";
+
+            if (random.bounded(2))
+                version += QString::number(random.bounded(12));
+            else
+                version += IDENTIFIERS[random.bounded(identifierCount)];
+        }
+
+        if (random.bounded(8) == 0)
+            version += "+build.5";
+        versions.append(version);
+    }
+
+    QList<ZVersion> parsed;
+    QList<QByteArray> literals;
+    QList<Reference> references;
+    for (const QString &version : std::as_const(versions)) {
+        parsed.append(ZVersion::fromString(version));
+        literals.append(version.toLatin1());
+        references.append(reference(version));
+    }
+
+    for (int i = 0; i < versions.size(); ++i) {
+        ZVersion literal(literals.at(i).constData());
+        for (int j = 0; j < versions.size(); ++j) {
+            int expected = referenceCompare(references[i], references[j]);
+            if (sign(parsed[i].compare(parsed[j])) != expected ||
+                sign(literal.compare(parsed[j])) != expected)
+                QFAIL(qPrintable(versions[i] + " vs " + versions[j]));
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_ZVersion)
+#include "tst_ZVersion.moc"